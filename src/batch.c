@@ -0,0 +1,323 @@
+/** @file
+  Implementation of the batch mode of the calculator.
+  The scripts are dealt out in equal ranges, one range per thread.
+  A thread takes the scripts from the beginning of its own range and,
+  when the range is empty, steals the last script of the range of another
+  thread, so a few long scripts do not keep the other threads idle.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+#include "command.h"
+#include "mallocSafe.h"
+#include "output.h"
+#include "polyMemo.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * This is a script of the batch.
+ */
+typedef struct {
+    char *name;           ///< name of the file
+    char *path;           ///< path of the file
+    long microseconds;    ///< time of the script
+    bool done;            ///< Has the script been performed?
+} script;
+
+/**
+ * This is the range of the scripts of one thread.
+ */
+typedef struct {
+    size_t next;            ///< index of the next script of the owner
+    size_t end;             ///< index after the last script
+    pthread_mutex_t lock;   ///< lock of the range
+} range;
+
+/**
+ * This is the state shared by the threads.
+ */
+typedef struct {
+    script *Scripts;    ///< scripts
+    range *Ranges;      ///< ranges of the threads
+    size_t threads;     ///< number of threads
+    size_t memo;        ///< memory limit of the cache of a script
+} batch;
+
+/**
+ * This is the argument of a thread.
+ */
+typedef struct {
+    batch *Batch;    ///< batch
+    size_t index;    ///< index of the range of the thread
+} worker;
+
+/**
+ * The function checks if the name ends with the given ending.
+ * @param[in] name : name
+ * @param[in] ending : ending
+ * @return Does the name end with the ending?
+ */
+static bool endsWith(const char *name, const char *ending) {
+    size_t length = strlen(name);
+    size_t size = strlen(ending);
+
+    return length >= size && strcmp(name + length - size, ending) == 0;
+}
+
+/**
+ * The function joins the strings into a new one.
+ * @param[in] a : first string
+ * @param[in] b : second string
+ * @param[in] c : third string
+ * @return joined string
+ */
+static char *join(const char *a, const char *b, const char *c) {
+    size_t length = strlen(a) + strlen(b) + strlen(c);
+    char *s = (char *) mallocSafe(length + 1);
+    strcpy(s, a);
+    strcat(s, b);
+    strcat(s, c);
+
+    return s;
+}
+
+/**
+ * The function compares the scripts by their names, for qsort.
+ * @param[in] a : script
+ * @param[in] b : script
+ * @return result of the comparison
+ */
+static int compareScripts(const void *a, const void *b) {
+    return strcmp(((const script *) a)->name, ((const script *) b)->name);
+}
+
+/**
+ * The function lists the scripts of the directory in the order of the names.
+ * @param[in] directory : path of the directory
+ * @param[out] Scripts : array of scripts
+ * @param[out] count : number of scripts
+ * @return Has the directory been read?
+ */
+static bool listScripts(const char *directory, script **Scripts, size_t *count) {
+    DIR *Directory = opendir(directory);
+    if (Directory == NULL) {
+        return false;
+    }
+
+    *Scripts = NULL;
+    size_t capacity = 0;
+    *count = 0;
+    struct dirent *Entry;
+    while ((Entry = readdir(Directory)) != NULL) {
+        const char *name = Entry->d_name;
+        if (name[0] == '.' || endsWith(name, ".out") || endsWith(name, ".err")) {
+            continue;
+        }
+        char *path = join(directory, "/", name);
+        struct stat status;
+        if (stat(path, &status) != 0 || !S_ISREG(status.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = 2 * capacity + 16;
+            *Scripts = (script *) realloc(*Scripts, capacity * sizeof(script));
+            if (*Scripts == NULL) {
+                exit(1);
+            }
+        }
+        (*Scripts)[*count] = (script) {.name = join(name, "", ""), .path = path,
+                                       .microseconds = 0, .done = false};
+        ++*count;
+    }
+    closedir(Directory);
+
+    if (*count > 0) {
+        qsort(*Scripts, *count, sizeof(script), compareScripts);
+    }
+
+    return true;
+}
+
+/**
+ * The function gives the time elapsed since the given moment.
+ * @param[in] start : moment
+ * @return time in microseconds
+ */
+static long elapsed(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/**
+ * The function performs the script, writing its output and error messages
+ * to the files next to it.
+ * @param[in,out] Script : script
+ * @param[in] memo : memory limit of the cache
+ */
+static void perform(script *Script, size_t memo) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    char *outName = join(Script->path, ".out", "");
+    char *errName = join(Script->path, ".err", "");
+    int in = open(Script->path, O_RDONLY | O_CLOEXEC);
+    int out = open(outName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int err = open(errName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    free(outName);
+    free(errName);
+
+    if (in >= 0 && out >= 0 && err >= 0) {
+        outputStream *Output = OutputOpen(out);
+        outputStream *Errors = OutputOpen(err);
+        OutputRedirect(Output, Errors);
+        PolyMemoStart(memo);
+        stack Stack = Init();
+
+        PerformInput(in, &Stack);
+
+        OutputClose(Output);
+        OutputClose(Errors);
+        PolyMemoStop();
+        Clear(&Stack);
+        Script->done = true;
+    }
+
+    if (in >= 0) {
+        close(in);
+    }
+    if (out >= 0) {
+        close(out);
+    }
+    if (err >= 0) {
+        close(err);
+    }
+    Script->microseconds = elapsed(&start);
+}
+
+/**
+ * The function takes a script from the range.
+ * @param[in,out] Range : range
+ * @param[in] own : Is it the range of the calling thread?
+ * @param[out] index : index of the script
+ * @return Was there a script in the range?
+ */
+static bool take(range *Range, bool own, size_t *index) {
+    pthread_mutex_lock(&(Range->lock));
+    bool found = Range->next < Range->end;
+    if (found) {
+        *index = own ? Range->next++ : --Range->end;
+    }
+    pthread_mutex_unlock(&(Range->lock));
+
+    return found;
+}
+
+/**
+ * The function of a thread: it performs the scripts of its range
+ * and then the ones stolen from the other ranges.
+ * @param[in] argument : worker
+ * @return NULL
+ */
+static void *run(void *argument) {
+    worker *Worker = (worker *) argument;
+    batch *Batch = Worker->Batch;
+    size_t index;
+
+    while (take(&(Batch->Ranges[Worker->index]), true, &index)) {
+        perform(&(Batch->Scripts[index]), Batch->memo);
+    }
+    for (size_t i = 1; i < Batch->threads; ++i) {
+        range *Victim = &(Batch->Ranges[(Worker->index + i) % Batch->threads]);
+        while (take(Victim, false, &index)) {
+            perform(&(Batch->Scripts[index]), Batch->memo);
+        }
+    }
+
+    return NULL;
+}
+
+bool RunBatch(const char *directory, size_t threads, size_t memo) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    script *Scripts;
+    size_t count;
+    if (!listScripts(directory, &Scripts, &count)) {
+        return false;
+    }
+
+    if (threads == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = processors > 0 ? (size_t) processors : 1;
+    }
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+
+    batch Batch = {.Scripts = Scripts, .threads = threads, .memo = memo};
+    Batch.Ranges = (range *) mallocSafe(threads * sizeof(range));
+    worker *Workers = (worker *) mallocSafe(threads * sizeof(worker));
+    pthread_t *Threads = (pthread_t *) mallocSafe(threads * sizeof(pthread_t));
+    bool *started = (bool *) mallocSafe(threads * sizeof(bool));
+    for (size_t t = 0; t < threads; ++t) {
+        Batch.Ranges[t].next = count * t / threads;
+        Batch.Ranges[t].end = count * (t + 1) / threads;
+        pthread_mutex_init(&(Batch.Ranges[t].lock), NULL);
+        Workers[t] = (worker) {.Batch = &Batch, .index = t};
+    }
+
+    // The calling thread is the first worker, the ranges of the threads
+    // which could not be started are stolen by the others.
+    for (size_t t = 1; t < threads; ++t) {
+        started[t] = pthread_create(&(Threads[t]), NULL, run, &(Workers[t])) == 0;
+    }
+    run(&(Workers[0]));
+    for (size_t t = 1; t < threads; ++t) {
+        if (started[t]) {
+            pthread_join(Threads[t], NULL);
+        }
+    }
+
+    bool all = true;
+    for (size_t i = 0; i < count; ++i) {
+        OutputString(Scripts[i].name);
+        if (Scripts[i].done) {
+            OutputChar(' ');
+            OutputLong(Scripts[i].microseconds);
+            OutputChar('\n');
+        } else {
+            OutputString(" FAILED\n");
+            all = false;
+        }
+        free(Scripts[i].name);
+        free(Scripts[i].path);
+    }
+    OutputString("TOTAL ");
+    OutputLong(elapsed(&start));
+    OutputChar('\n');
+
+    for (size_t t = 0; t < threads; ++t) {
+        pthread_mutex_destroy(&(Batch.Ranges[t].lock));
+    }
+    free(Batch.Ranges);
+    free(Workers);
+    free(Threads);
+    free(started);
+    free(Scripts);
+
+    return all;
+}
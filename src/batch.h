@@ -0,0 +1,30 @@
+/** @file
+  Interface of the batch mode of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The function performs every script in the directory, each one with a stack
+ * of its own, exactly as if it was the standard input. The output of the script
+ * "name" is written to the file "name.out" and its error messages to the file
+ * "name.err" in the same directory, the files with these endings and the hidden
+ * files are not scripts. The scripts are run concurrently by a pool of threads,
+ * which take the scripts of one another when they run out of their own.
+ * At the end, the time of every script in microseconds is printed,
+ * one script per line in the order of the names, and then the total time.
+ * @param[in] directory : path of the directory
+ * @param[in] threads : number of threads, 0 for the number of processors
+ * @param[in] memo : memory limit of the cache of every script in bytes
+ * @return Has every script been performed?
+ */
+bool RunBatch(const char *directory, size_t threads, size_t memo);
+
+#endif /* __BATCH_H__ */
@@ -7,142 +7,253 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include "batch.h"
 #include "command.h"
+#include "lazy.h"
+#include "output.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "polyMemo.h"
+#include "program.h"
 #include "savePoly.h"
+#include "server.h"
+#include "stats.h"
 
 /**
- * Function recognize the command.
+ * Function checks if the line is neither empty nor a comment.
  * @param[in] Line : line
- * @param[in,out] Stack : stack
- * @param[in] numberofLine : number of line
+ * @return Is the line counted by the statistics?
  */
-static void command(const line *Line, stack *Stack, size_t numberofLine) {
-    bool done = false;
-    if (strcmp(Line->letters, "ZERO") == 0 && Line->numberofLetters == strlen("ZERO")) {
-        ZERO(Stack);
-        done = true;
-    }
-    if (strcmp(Line->letters, "IS_COEFF") == 0 && Line->numberofLetters == strlen("IS_COEFF")) {
-        IS_COEFF(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "IS_ZERO") == 0 && Line->numberofLetters == strlen("IS_ZERO")) {
-        IS_ZERO(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "CLONE") == 0 && Line->numberofLetters == strlen("CLONE")) {
-        CLONE(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "ADD") == 0 && Line->numberofLetters == strlen("ADD")) {
-        ADD(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "MUL") == 0 && Line->numberofLetters == strlen("MUL")) {
-        MUL(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "NEG") == 0 && Line->numberofLetters == strlen("NEG")) {
-        NEG(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "SUB") == 0 && Line->numberofLetters == strlen("SUB")) {
-        SUB(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "IS_EQ") == 0 && Line->numberofLetters == strlen("IS_EQ")) {
-        IS_EQ(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "DEG") == 0 && Line->numberofLetters == strlen("DEG")) {
-        DEG(Stack, numberofLine);
-        done = true;
-    }
-    if (strncmp(Line->letters, "DEG_BY", strlen("DEG_BY"))) {
-        DEG_BY(Stack, numberofLine, Line);
-        done = true;
-    }
-    if (strncmp(Line->letters, "AT", strlen("AT"))) {
-        AT(Stack, numberofLine, Line);
-        done = true;
-    }
-    if (strcmp(Line->letters, "PRINT") == 0 && Line->numberofLetters == strlen("PRINT")) {
-        PRINT(Stack, numberofLine);
-        done = true;
-    }
-    if (strcmp(Line->letters, "POP") == 0 && Line->numberofLetters == strlen("POP")) {
-        POP(Stack, numberofLine);
-        done = true;
-    }
-    if (strncmp(Line->letters, "COMPOSE", strlen("COMPOSE"))) {
-        COMPOSE(Stack, numberofLine, Line);
-        done = true;
-    }
-    if (!done) {
-        fprintf(stderr, "ERROR %ld WRONG COMMAND\n", numberofLine);
-    }
+static bool counted(const line *Line) {
+    return Line->numberofLetters > 0 && Line->letters[0] != '#';
 }
 
 /**
- * Function recognize if line contains command or polynomial and
- * then save it and frees Line. Function ignores empty lines.
- * @param[in,out] Line : line
+ * Function reads the standard input line by line and performs the lines.
  * @param[in,out] Stack : stack
- * @param[in] numberofLine : number of Line
+ * @param[in] stats : Are the statistics of the lines on, see stats.h?
  */
-static void recognize(line *Line, stack *Stack, size_t numberofLine) {
-    if (Line->numberofLetters != 0) {
-        if (!(Line->numberofLetters == 1 && Line->letters[0] == '\n')) {
-            if ((Line->letters[0] >= 'A' && Line->letters[0] <= 'Z') ||
-            (Line->letters[0] >= 'a' && Line->letters[0] <= 'z') ) {
-                command(Line, Stack, numberofLine);
-            } else {
-                savePoly(Line, Stack, numberofLine);
-            }
+static void readInput(stack *Stack, bool stats) {
+    lineReader *Reader = OpenReader(STDIN_FILENO);
+    line Line;
+    size_t numberofLine = 0;
+
+    while (NextLine(Reader, &Line)) {
+        ++numberofLine;
+        if (stats && counted(&Line)) {
+            size_t kind = StatsKind(&Line);
+            StatsBegin();
+            PerformLine(&Line, Stack, numberofLine);
+            StatsEnd(kind);
+        } else {
+            PerformLine(&Line, Stack, numberofLine);
         }
     }
-    free(Line->letters);
-    free(Line);
+
+    CloseReader(Reader);
 }
 
 /**
- * Function reads input char by char and ignores lines started with "#".
+ * Function reads the standard input line by line and performs the lines
+ * in the lazy mode, see lazy.h.
  * @param[in,out] Stack : stack
+ * @param[in] stats : Are the statistics of the lines on, see stats.h?
  */
-static void readInput(stack *Stack) {
-    int k = getchar();
+static void readLazy(stack *Stack, bool stats) {
+    lazyStack Lazy = LazyInit(Stack);
+    lineReader *Reader = OpenReader(STDIN_FILENO);
+    line Line;
     size_t numberofLine = 0;
-    while (k != EOF) {
+    Poly p;
+
+    while (NextLine(Reader, &Line)) {
         ++numberofLine;
-        line *Line = createaLine();
-        if (k == '#') {
-            while (k != '\n' && k != EOF) {
-                k = getchar();
-            }
+        if (!counted(&Line)) {
+            continue;
         }
-        while (k != '\n' && k != EOF) {
-            if (Line->sizeofArray == Line->numberofLetters + 1) {
-                enlargeLine(Line);
-            }
-            Line->letters[Line->numberofLetters] = (char) k;
-            ++Line->numberofLetters;
-            k = getchar();
+        size_t kind = 0;
+        if (stats) {
+            kind = StatsKind(&Line);
+            StatsBegin();
+        }
+        if (IsCommand(&Line)) {
+            LazyExecute(&Lazy, Decode(&Line), &Line, numberofLine);
+        } else if (ParsePoly(Line.letters, Line.numberofLetters, &p)) {
+            LazyPush(&Lazy, p);
+        } else {
+            OutputError(numberofLine, "WRONG POLY");
+        }
+        if (stats) {
+            StatsEnd(kind);
         }
-        recognize(Line, Stack, numberofLine);
-        k = getchar();
     }
+
+    CloseReader(Reader);
+    LazyClear(&Lazy);
+}
+
+/**
+ * Function prints how to run the calculator.
+ * @param[in] name : name of the program
+ * @return error code
+ */
+static int usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--pipeline | --compile | --lazy] [--async-output] "
+            "[--memo bytes] [--restore file] [--stats] [--timings] [--profile]\n"
+            "       %s --socket path | --batch directory [-j threads] [--memo bytes]\n",
+            name, name);
+    return 1;
 }
 
 /**
  * Function create empty stack, read input and performs commands.
+ * With the option "--pipeline" reading, parsing and performing
+ * of the lines overlap. With the option "--async-output" the output
+ * is written by a separate thread. With the option "--restore file"
+ * the stack starts with the polynomials from the checkpoint file.
+ * With the option "--compile" the whole input is compiled and optimized
+ * before it is performed. With the option "--lazy" the arithmetic commands
+ * are evaluated only when their results are needed, this option can not be
+ * combined with "--pipeline" nor "--compile". With the option "--memo bytes"
+ * the results of the multiplications, compositions and evaluations are cached
+ * in at most the given number of bytes, the command MEMO prints the numbers
+ * of the cache hits and misses. With the option "--socket path" the calculator
+ * is a server listening on the Unix domain socket, every connection is performed
+ * as a separate input with a stack of its own, by a pool of "-j threads" threads,
+ * see server.h. With the option "--batch directory" every script in the directory
+ * is performed with a stack of its own, by "-j threads" threads, see batch.h.
+ * With the option "--stats" the memory allocated by the polynomials is counted,
+ * see the command STATS, and a summary of the allocations of every kind
+ * of lines is written to the standard error at the end, see stats.h,
+ * this option can not be combined with "--pipeline", "--compile" nor the pools.
+ * With the option "--timings" the time of every line is measured,
+ * the percentiles for every kind of lines are printed by the command TIMINGS
+ * and written to the standard error at the end, with the same restrictions.
+ * In the lazy mode the time of the arithmetic commands goes to the lines
+ * which force them. With the option "--profile" the hardware performance
+ * counters are read around every line and around the multiplication
+ * and the merging of monomials in the library, the counts are written
+ * to the standard error at the end, see profile.h, with the same restrictions.
+ * @param[in] argc : number of arguments
+ * @param[in] argv : arguments
  * @return 0 when performed correctly, error code otherwise.
  */
-int main(void) {
+int main(int argc, char *argv[]) {
+    bool pipelined = false;
+    bool async = false;
+    bool compiled = false;
+    bool lazy = false;
+    bool stats = false;
+    bool timings = false;
+    bool profile = false;
+    const char *restore = NULL;
+    size_t memo = 0;
+    const char *socketPath = NULL;
+    const char *batchDirectory = NULL;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--pipeline") == 0) {
+            pipelined = true;
+        } else if (strcmp(argv[i], "--async-output") == 0) {
+            async = true;
+        } else if (strcmp(argv[i], "--compile") == 0) {
+            compiled = true;
+        } else if (strcmp(argv[i], "--lazy") == 0) {
+            lazy = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--timings") == 0) {
+            timings = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--memo") == 0 && i + 1 < argc) {
+            char *end;
+            ++i;
+            memo = strtoull(argv[i], &end, 10);
+            if (*end != 0 || argv[i][0] < '0' || argv[i][0] > '9') {
+                return usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            char *end;
+            ++i;
+            threads = strtoull(argv[i], &end, 10);
+            if (*end != 0 || argv[i][0] < '1' || argv[i][0] > '9') {
+                return usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            ++i;
+            socketPath = argv[i];
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            ++i;
+            batchDirectory = argv[i];
+        } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            ++i;
+            restore = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    bool lines = stats || timings || profile;
+    if ((lazy || lines) && (pipelined || compiled)) {
+        return usage(argv[0]);
+    }
+    bool pooled = socketPath != NULL || batchDirectory != NULL;
+    if (pooled ? pipelined || compiled || lazy || lines || async || restore != NULL ||
+                 (socketPath != NULL && batchDirectory != NULL) : threads != 0) {
+        return usage(argv[0]);
+    }
+    if (socketPath != NULL) {
+        if (!RunServer(socketPath, threads, memo)) {
+            fprintf(stderr, "ERROR SERVER FAILED\n");
+            return 1;
+        }
+        return 0;
+    }
+    if (batchDirectory != NULL) {
+        OutputStart(false);
+        if (!RunBatch(batchDirectory, threads, memo)) {
+            OutputFlush();
+            fprintf(stderr, "ERROR BATCH FAILED\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    if (profile && !ProfileStart()) {
+        fprintf(stderr, "ERROR PROFILE UNAVAILABLE\n");
+        return 1;
+    }
+    if (lines) {
+        StatsStart(stats, timings);
+    }
+    OutputStart(async);
+    PolyMemoStart(memo);
     stack Stack = Init();
 
-    readInput(&Stack);
+    if (restore != NULL && !RestoreStack(&Stack, restore)) {
+        fprintf(stderr, "ERROR RESTORE FAILED\n");
+        Clear(&Stack);
+        return 1;
+    }
+
+    if (compiled) {
+        program *Program = Compile(STDIN_FILENO);
+        RunProgram(Program, &Stack, true);
+        FreeProgram(Program);
+    } else if (lazy) {
+        readLazy(&Stack, lines);
+    } else if (!pipelined || !RunPipeline(STDIN_FILENO, &Stack)) {
+        readInput(&Stack, lines);
+    }
 
+    PolyMemoStop();
     Clear(&Stack);
+    if (lines) {
+        OutputFlush();
+        StatsReport();
+    }
     
     return 0;
 }
@@ -5,11 +5,21 @@
   @date 2021
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "command.h"
 #include "mallocSafe.h"
+#include "output.h"
+#include "polyFile.h"
+#include "polyMemo.h"
+#include "reclaim.h"
+#include "savePoly.h"
+#include "stats.h"
+#include <fcntl.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
+#include <unistd.h>
 
 void ZERO(stack *Stack) {
     Poly p = PolyZero();
@@ -18,33 +28,33 @@ void ZERO(stack *Stack) {
 
 void IS_COEFF(const stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Top(Stack);
         if (PolyIsCoeff(&p)) {
-            printf("1\n");
+            OutputString("1\n");
         } else {
-            printf("0\n");
+            OutputString("0\n");
         }
     }
 }
 
 void IS_ZERO(const stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Top(Stack);
         if (PolyIsZero(&p)) {
-            printf("1\n");
+            OutputString("1\n");
         } else {
-            printf("0\n");
+            OutputString("0\n");
         }
     }
 }
 
 void CLONE(stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Top(Stack);
         Poly q = PolyClone(&p);
@@ -54,76 +64,77 @@ void CLONE(stack *Stack, size_t numberofLine) {
 
 void ADD(stack *Stack, size_t numberofLine) {
     if (Stack->top < 2) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Pop(Stack);
         Poly q = Pop(Stack);
         Poly r = PolyAdd(&p, &q);
         Push(Stack, r);
-        PolyDestroy(&p);
-        PolyDestroy(&q);
+        PolyDestroyDeferred(&p);
+        PolyDestroyDeferred(&q);
     }
 }
 
 void MUL(stack *Stack, size_t numberofLine) {
     if (Stack->top < 2) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Pop(Stack);
         Poly q = Pop(Stack);
-        Poly r = PolyMul(&p, &q);
+        Poly r = PolyMemoMul(&p, &q);
         Push(Stack, r);
-        PolyDestroy(&p);
-        PolyDestroy(&q);
+        PolyDestroyDeferred(&p);
+        PolyDestroyDeferred(&q);
     }
 }
 
 void NEG(stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Pop(Stack);
         Poly r = PolyNeg(&p);
         Push(Stack, r);
-        PolyDestroy(&p);
+        PolyDestroyDeferred(&p);
     }
 }
 
 void SUB(stack *Stack, size_t numberofLine) {
     if (Stack->top < 2) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Pop(Stack);
         Poly q = Pop(Stack);
         Poly r = PolySub(&p, &q);
         Push(Stack, r);
-        PolyDestroy(&p);
-        PolyDestroy(&q);
+        PolyDestroyDeferred(&p);
+        PolyDestroyDeferred(&q);
     }
 }
 
 void IS_EQ(stack *Stack, size_t numberofLine) {
     if (Stack->top < 2) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Pop(Stack);
         Poly q = Top(Stack);
         Push(Stack, p);
         if (PolyIsEq(&p, &q)) {
-            printf("1\n");
+            OutputString("1\n");
         } else {
-            printf("0\n");
+            OutputString("0\n");
         }
     }
 }
 
 void DEG(const stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Top(Stack);
         poly_exp_t i = PolyDeg(&p);
-        printf("%d\n", i);
+        OutputLong(i);
+        OutputChar('\n');
     }
 }
 
@@ -144,8 +155,7 @@ static bool correctIdx(const line *Line, ullint var_idx, size_t start) {
         correct = false;
     }
 
-    if (strcmp(&(Line->letters[start]),
-     "18446744073709551615") == 0) {
+    if (LineRestIs(Line, start, "18446744073709551615")) {
         correct = true;
     }
 
@@ -165,104 +175,141 @@ static void DEG_BY_Help(const line *Line, const stack *Stack, size_t numberofLin
     
     ullint var_idx = strtoull(&(Line->letters[strlen("DEG_BY") + 1]), &end, 10);
 
-    if (correctIdx(Line, var_idx, strlen("DEG_BY") + 1) && end[0] == 0) {
+    if (correctIdx(Line, var_idx, strlen("DEG_BY") + 1) && end == Line->letters + Line->numberofLetters) {
         if (Empty(Stack)) {
-            fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n",numberofLine);
+            OutputError(numberofLine, "STACK UNDERFLOW");
         } else {
             Poly p = Top(Stack);
             size_t idx = (size_t) var_idx;
             poly_exp_t x = PolyDegBy(&p, idx);
-            printf("%d\n", x);
+            OutputLong(x);
+            OutputChar('\n');
         }
     } else {
-        fprintf(stderr, "ERROR %ld DEG BY WRONG VARIABLE\n",numberofLine);
+        OutputError(numberofLine, "DEG BY WRONG VARIABLE");
     }
 }
 
 void DEG_BY(const stack *Stack, size_t numberofLine, const line *Line) {
     if (Line->numberofLetters == strlen("DEG_BY")) {
-        fprintf(stderr, "ERROR %ld DEG BY WRONG VARIABLE\n", numberofLine);
+        OutputError(numberofLine, "DEG BY WRONG VARIABLE");
     } else {
         if (Line->letters[strlen("DEG_BY")] != ' ') {
-            fprintf(stderr, "ERROR %ld WRONG COMMAND\n", numberofLine);
+            OutputError(numberofLine, "WRONG COMMAND");
         } else {
             if (Line->numberofLetters > strlen("DEG_BY") + 1) {
                 DEG_BY_Help(Line, Stack, numberofLine);
             } else {
-                fprintf(stderr, "ERROR %ld DEG BY WRONG VARIABLE\n", numberofLine);
+                OutputError(numberofLine, "DEG BY WRONG VARIABLE");
             }
         }
     }
 }
 
-/**
- * Funkcja sprawdza, czy wczytana wartość jest poprawna.
- * @param[in] Line : wiersz
- * @param[in] variable : wartość
- * @return Czy poprawna wartość?
- */
-static bool correctVariable(const line *Line, llint variable) {
-    bool correct = (variable < LLONG_MAX) && (variable > LLONG_MIN) &&
-                      ((Line->letters[strlen("AT ")] >= '0' && Line->letters[strlen("AT ")] <= '9') ||
-                       Line->letters[strlen("AT ")] == '-');
-
-    if (variable == 0 && !(Line->letters[strlen("AT ")] == '0' 
-    && Line->numberofLetters == strlen("AT 0") )) {
-        correct = false;
+bool AtValue(const line *Line, size_t numberofLine, poly_coeff_t *x) {
+    if (Line->numberofLetters == strlen("AT")) {
+        OutputError(numberofLine, "AT WRONG VALUE");
+        return false;
+    }
+    if (Line->letters[strlen("AT")] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+        return false;
     }
 
-    if (strcmp(&(Line->letters[3]), "-9223372036854775808") == 0 ||
-    strcmp(&(Line->letters[3]), "9223372036854775807") == 0) {
-        correct = true;
+    // Zero is only written as "0" here.
+    size_t i = strlen("AT ");
+    if (!ParseCoeff(Line->letters, Line->numberofLetters, &i, x) ||
+        i != Line->numberofLetters || LineRestIs(Line, strlen("AT "), "-0")) {
+        OutputError(numberofLine, "AT WRONG VALUE");
+        return false;
     }
 
-    return correct;
+    return true;
 }
 
 void AT(stack *Stack, size_t numberofLine, const line *Line) {
-    if (Line->numberofLetters == strlen("AT")) {
-        fprintf(stderr, "ERROR %ld AT WRONG VALUE\n", numberofLine);
-    } else {
-        if (Line->letters[strlen("AT")] != ' ') {
-            fprintf(stderr, "ERROR %ld WRONG COMMAND\n", numberofLine);
+    poly_coeff_t x;
+
+    if (AtValue(Line, numberofLine, &x)) {
+        if (Empty(Stack)) {
+            OutputError(numberofLine, "STACK UNDERFLOW");
         } else {
-            char *end;
-            llint x = strtoll(&(Line->letters[strlen("AT ")]), &end, 10);
-            if (correctVariable(Line, x) && end[0] == 0) {
-                if (Empty(Stack)) {
-                    fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
-                } else {
-                    Poly p = Pop(Stack);
-                    Poly q = PolyAt(&p, x);
-                    Push(Stack, q);
-                    PolyDestroy(&p);
-                }
-            } else {
-                fprintf(stderr, "ERROR %ld AT WRONG VALUE\n", numberofLine);
-            }
+            Poly p = Pop(Stack);
+            Poly q = PolyMemoAt(&p, x);
+            Push(Stack, q);
+            PolyDestroyDeferred(&p);
         }
     }
 }
 
 void PRINT(const stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Top(Stack);
         PrintPoly(&p);
-        printf("\n");
+        OutputChar('\n');
     }
 }
 
 void POP(stack *Stack, size_t numberofLine) {
     if (Empty(Stack)) {
-        fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+        OutputError(numberofLine, "STACK UNDERFLOW");
     } else {
         Poly p = Pop(Stack);
-        PolyDestroy(&p);
+        PolyDestroyDeferred(&p);
     }
 }
 
+void FORCE(const stack *Stack) {
+    (void) Stack;
+}
+
+void MEMO(void) {
+    size_t hits;
+    size_t misses;
+
+    PolyMemoCounters(&hits, &misses);
+    OutputLong((long) hits);
+    OutputChar(' ');
+    OutputLong((long) misses);
+    OutputChar('\n');
+}
+
+void STATS(const stack *Stack, size_t numberofLine) {
+    if (Empty(Stack)) {
+        OutputError(numberofLine, "STACK UNDERFLOW");
+        return;
+    }
+
+    // The polynomials waiting for the reclamation thread are freed already.
+    ReclaimDrain();
+    Poly p = Top(Stack);
+    PolySizes sizes = PolyMeasure(&p);
+    PolyMemoryCounters counters;
+    PolyGetMemoryCounters(&counters);
+
+    OutputString("terms ");
+    OutputLong((long) sizes.terms);
+    OutputString(" nodes ");
+    OutputLong((long) sizes.nodes);
+    OutputString(" depth ");
+    OutputLong((long) sizes.depth);
+    OutputString(" bytes ");
+    OutputLong((long) sizes.bytes);
+    OutputString(" live ");
+    OutputLong((long) counters.live);
+    OutputString(" peak ");
+    OutputLong((long) counters.peak);
+    OutputString(" allocations ");
+    OutputLong((long) counters.allocations);
+    OutputChar('\n');
+}
+
+void TIMINGS(void) {
+    StatsTimings();
+}
+
 /**
  * Funkcja ta to właściwa część funkcji COMPOSE, kiedy wiemy już, że po
  * poleceniu "COMPOSE" następuje spacja i nie jest ona ostatnim znakiem w wierszu.
@@ -274,9 +321,9 @@ static void ComposeHelp(stack *Stack, size_t numberofLine, const line *Line) {
     char *end;
     ullint k = strtoull(&(Line->letters[8]), &end, 10);
 
-    if (correctIdx(Line, k, 8) && end[0] == 0) {
-        if (Stack->top - 1 < k) {
-            fprintf(stderr, "ERROR %ld STACK UNDERFLOW\n", numberofLine);
+    if (correctIdx(Line, k, 8) && end == Line->letters + Line->numberofLetters) {
+        if (Stack->top == 0 || Stack->top - 1 < k) {
+            OutputError(numberofLine, "STACK UNDERFLOW");
         } else {
             Poly p = Pop(Stack);
 
@@ -285,32 +332,485 @@ static void ComposeHelp(stack *Stack, size_t numberofLine, const line *Line) {
                 q[k - i] = Pop(Stack);
             }
         
-            Poly r = PolyCompose(&p, k, q);
+            Poly r = PolyMemoCompose(&p, k, q);
             Push(Stack, r);
 
-            PolyDestroy(&p);
+            PolyDestroyDeferred(&p);
             for (ullint i = 0; i < k; ++i) {
-                PolyDestroy(&(q[i]));
+                PolyDestroyDeferred(&(q[i]));
             }
             free(q);
         }
     } else {
-        fprintf(stderr, "ERROR %ld COMPOSE WRONG PARAMETER\n", numberofLine);
+        OutputError(numberofLine, "COMPOSE WRONG PARAMETER");
     }   
 }
 
 void COMPOSE(stack *Stack, size_t numberofLine, const line *Line) {
     if (Line->numberofLetters == 7) {
-        fprintf(stderr, "ERROR %ld COMPOSE WRONG PARAMETER\n", numberofLine);
+        OutputError(numberofLine, "COMPOSE WRONG PARAMETER");
     } else {
         if (Line->letters[7] != ' ') {
-            fprintf(stderr, "ERROR %ld WRONG COMMAND\n", numberofLine);
+            OutputError(numberofLine, "WRONG COMMAND");
         } else {
             if (Line->numberofLetters > 8) {
                 ComposeHelp(Stack, numberofLine, Line);
             } else {
-                fprintf(stderr, "ERROR %ld COMPOSE WRONG PARAMETER\n", numberofLine);
+                OutputError(numberofLine, "COMPOSE WRONG PARAMETER");
             }
         }
     }
 }
+
+/**
+ * The function reads a non-negative number, not greater than POLY_EXP_MAX,
+ * written with digits only and starting at the index @p start.
+ * @param[in] Line : line
+ * @param[in] start : starting index
+ * @param[out] x : read value
+ * @return index of the first character after the number, 0 if there is no correct number
+ */
+static size_t readBound(const line *Line, size_t start, poly_exp_t *x) {
+    size_t i = start;
+    long long value = 0;
+
+    while (i < Line->numberofLetters && Line->letters[i] >= '0' && Line->letters[i] <= '9') {
+        value = 10 * value + (Line->letters[i] - '0');
+        if (value > POLY_EXP_MAX) {
+            return 0;
+        }
+        ++i;
+    }
+
+    if (i == start) {
+        return 0;
+    }
+
+    *x = (poly_exp_t) value;
+    return i;
+}
+
+void MUL_TRUNC(stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("MUL_TRUNC ");
+    poly_exp_t deg;
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+    } else if (Line->numberofLetters > start &&
+               readBound(Line, start, &deg) == Line->numberofLetters) {
+        if (Stack->top < 2) {
+            OutputError(numberofLine, "STACK UNDERFLOW");
+        } else {
+            Poly p = Pop(Stack);
+            Poly q = Pop(Stack);
+            Poly r = PolyMulTrunc(&p, &q, deg);
+            Push(Stack, r);
+            PolyDestroyDeferred(&p);
+            PolyDestroyDeferred(&q);
+        }
+    } else {
+        OutputError(numberofLine, "MUL TRUNC WRONG PARAMETER");
+    }
+}
+
+void EXP_TRUNC(stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("EXP_TRUNC ");
+    poly_exp_t exp;
+    poly_exp_t deg;
+    size_t space = 0;
+
+    if (Line->numberofLetters > start) {
+        space = readBound(Line, start, &exp);
+    }
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+    } else if (space != 0 && space < Line->numberofLetters && Line->letters[space] == ' ' &&
+               readBound(Line, space + 1, &deg) == Line->numberofLetters) {
+        if (Empty(Stack)) {
+            OutputError(numberofLine, "STACK UNDERFLOW");
+        } else {
+            Poly p = Pop(Stack);
+            Poly r = PolyExpTrunc(&p, exp, deg);
+            Push(Stack, r);
+            PolyDestroyDeferred(&p);
+        }
+    } else {
+        OutputError(numberofLine, "EXP TRUNC WRONG PARAMETER");
+    }
+}
+
+/**
+ * The function copies the file name written in the line from the given index
+ * to the end of the line.
+ * @param[in] Line : line
+ * @param[in] start : index of the beginning of the name
+ * @return name ending with 0, NULL if the name is empty or holds the character 0
+ */
+static char *fileName(const line *Line, size_t start) {
+    if (Line->numberofLetters <= start ||
+        memchr(Line->letters + start, 0, Line->numberofLetters - start) != NULL) {
+        return NULL;
+    }
+
+    size_t length = Line->numberofLetters - start;
+    char *name = (char *) mallocSafe(length + 1);
+    memcpy(name, Line->letters + start, length);
+    name[length] = 0;
+
+    return name;
+}
+
+void SAVE(const stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("SAVE ");
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+        return;
+    }
+
+    char *name = fileName(Line, start);
+    if (name == NULL) {
+        OutputError(numberofLine, "SAVE WRONG FILE");
+    } else if (Empty(Stack)) {
+        OutputError(numberofLine, "STACK UNDERFLOW");
+    } else {
+        Poly p = Top(Stack);
+        int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool correct = fd >= 0 && PolyWriteFile(&p, fd);
+        if (fd >= 0 && close(fd) != 0) {
+            correct = false;
+        }
+        if (!correct) {
+            OutputError(numberofLine, "SAVE FAILED");
+        }
+    }
+    free(name);
+}
+
+void LOAD(stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("LOAD ");
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+        return;
+    }
+
+    char *name = fileName(Line, start);
+    if (name == NULL) {
+        OutputError(numberofLine, "LOAD WRONG FILE");
+    } else {
+        Poly p;
+        int fd = open(name, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0 && PolyReadFile(fd, &p)) {
+            Push(Stack, p);
+        } else {
+            OutputError(numberofLine, "LOAD FAILED");
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    free(name);
+}
+
+void CHECKPOINT(const stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("CHECKPOINT ");
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+        return;
+    }
+
+    char *name = fileName(Line, start);
+    if (name == NULL) {
+        OutputError(numberofLine, "CHECKPOINT WRONG FILE");
+        return;
+    }
+
+    // The checkpoint replaces the old one only once it is complete on the disk.
+    size_t length = strlen(name);
+    char *temporary = (char *) mallocSafe(length + strlen(".tmp") + 1);
+    memcpy(temporary, name, length);
+    strcpy(temporary + length, ".tmp");
+
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool correct = fd >= 0 && PolyWriteStackFile(Stack->top, Stack->Array, fd) &&
+                   fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0) {
+        correct = false;
+    }
+    correct = correct && rename(temporary, name) == 0;
+    if (!correct) {
+        if (fd >= 0) {
+            unlink(temporary);
+        }
+        OutputError(numberofLine, "CHECKPOINT FAILED");
+    }
+
+    free(temporary);
+    free(name);
+}
+
+bool RestoreStack(stack *Stack, const char *name) {
+    size_t count;
+    Poly *polys;
+    int fd = open(name, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+    bool correct = PolyReadStackFile(fd, &count, &polys);
+    close(fd);
+
+    if (correct) {
+        for (size_t i = 0; i < count; ++i) {
+            Push(Stack, polys[i]);
+        }
+        free(polys);
+    }
+
+    return correct;
+}
+
+void STORE(stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("STORE ");
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+    } else if (Line->numberofLetters <= start) {
+        OutputError(numberofLine, "STORE WRONG NAME");
+    } else if (Empty(Stack)) {
+        OutputError(numberofLine, "STACK UNDERFLOW");
+    } else {
+        RegisterStore(&(Stack->Registers), Line->letters + start,
+                      Line->numberofLetters - start, PolyShare(&(Stack->Array[Stack->top - 1])));
+    }
+}
+
+void RECALL(stack *Stack, size_t numberofLine, const line *Line) {
+    size_t start = strlen("RECALL ");
+
+    if (Line->numberofLetters > start - 1 && Line->letters[start - 1] != ' ') {
+        OutputError(numberofLine, "WRONG COMMAND");
+        return;
+    }
+
+    const Poly *p = NULL;
+    if (Line->numberofLetters > start) {
+        p = RegisterFind(Stack->Registers, Line->letters + start, Line->numberofLetters - start);
+    }
+    if (p == NULL) {
+        OutputError(numberofLine, "RECALL WRONG NAME");
+    } else {
+        Push(Stack, PolyShare(p));
+    }
+}
+
+bool IsCommand(const line *Line) {
+    return (Line->letters[0] >= 'A' && Line->letters[0] <= 'Z') ||
+           (Line->letters[0] >= 'a' && Line->letters[0] <= 'z');
+}
+
+/**
+ * The function checks if the name of the command is the given one.
+ * @param[in] letters : name of the command
+ * @param[in] length : length of the name
+ * @param[in] name : expected name
+ * @return Is it the expected name?
+ */
+static inline bool named(const char *letters, size_t length, const char *name) {
+    return strlen(name) == length && memcmp(letters, name, length) == 0;
+}
+
+opcode Decode(const line *Line) {
+    const char *space = memchr(Line->letters, ' ', Line->numberofLetters);
+    size_t length = space == NULL ? Line->numberofLetters : (size_t) (space - Line->letters);
+    const char *name = Line->letters;
+    opcode op = OP_WRONG;
+
+    switch (name[0]) {
+        case 'A':
+            op = named(name, length, "ADD") ? OP_ADD :
+                 named(name, length, "AT") ? OP_AT : OP_WRONG;
+            break;
+        case 'C':
+            op = named(name, length, "CLONE") ? OP_CLONE :
+                 named(name, length, "COMPOSE") ? OP_COMPOSE :
+                 named(name, length, "CHECKPOINT") ? OP_CHECKPOINT : OP_WRONG;
+            break;
+        case 'D':
+            op = named(name, length, "DEG") ? OP_DEG :
+                 named(name, length, "DEG_BY") ? OP_DEG_BY : OP_WRONG;
+            break;
+        case 'E':
+            op = named(name, length, "EXP_TRUNC") ? OP_EXP_TRUNC : OP_WRONG;
+            break;
+        case 'F':
+            op = named(name, length, "FORCE") ? OP_FORCE : OP_WRONG;
+            break;
+        case 'I':
+            op = named(name, length, "IS_COEFF") ? OP_IS_COEFF :
+                 named(name, length, "IS_ZERO") ? OP_IS_ZERO :
+                 named(name, length, "IS_EQ") ? OP_IS_EQ : OP_WRONG;
+            break;
+        case 'L':
+            op = named(name, length, "LOAD") ? OP_LOAD : OP_WRONG;
+            break;
+        case 'M':
+            op = named(name, length, "MUL") ? OP_MUL :
+                 named(name, length, "MUL_TRUNC") ? OP_MUL_TRUNC :
+                 named(name, length, "MEMO") ? OP_MEMO : OP_WRONG;
+            break;
+        case 'N':
+            op = named(name, length, "NEG") ? OP_NEG : OP_WRONG;
+            break;
+        case 'P':
+            op = named(name, length, "PRINT") ? OP_PRINT :
+                 named(name, length, "POP") ? OP_POP : OP_WRONG;
+            break;
+        case 'R':
+            op = named(name, length, "RECALL") ? OP_RECALL : OP_WRONG;
+            break;
+        case 'S':
+            op = named(name, length, "SUB") ? OP_SUB :
+                 named(name, length, "SAVE") ? OP_SAVE :
+                 named(name, length, "STATS") ? OP_STATS :
+                 named(name, length, "STORE") ? OP_STORE : OP_WRONG;
+            break;
+        case 'T':
+            op = named(name, length, "TIMINGS") ? OP_TIMINGS : OP_WRONG;
+            break;
+        case 'Z':
+            op = named(name, length, "ZERO") ? OP_ZERO : OP_WRONG;
+            break;
+        default:
+            break;
+    }
+
+    // Only the commands below take a parameter, the others must fill the whole line.
+    if (op < OP_DEG_BY && length != Line->numberofLetters) {
+        op = OP_WRONG;
+    }
+
+    return op;
+}
+
+void Execute(opcode op, const line *Line, stack *Stack, size_t numberofLine) {
+    switch (op) {
+        case OP_ZERO:
+            ZERO(Stack);
+            break;
+        case OP_IS_COEFF:
+            IS_COEFF(Stack, numberofLine);
+            break;
+        case OP_IS_ZERO:
+            IS_ZERO(Stack, numberofLine);
+            break;
+        case OP_CLONE:
+            CLONE(Stack, numberofLine);
+            break;
+        case OP_ADD:
+            ADD(Stack, numberofLine);
+            break;
+        case OP_MUL:
+            MUL(Stack, numberofLine);
+            break;
+        case OP_NEG:
+            NEG(Stack, numberofLine);
+            break;
+        case OP_SUB:
+            SUB(Stack, numberofLine);
+            break;
+        case OP_IS_EQ:
+            IS_EQ(Stack, numberofLine);
+            break;
+        case OP_DEG:
+            DEG(Stack, numberofLine);
+            break;
+        case OP_PRINT:
+            PRINT(Stack, numberofLine);
+            break;
+        case OP_POP:
+            POP(Stack, numberofLine);
+            break;
+        case OP_FORCE:
+            FORCE(Stack);
+            break;
+        case OP_MEMO:
+            MEMO();
+            break;
+        case OP_STATS:
+            STATS(Stack, numberofLine);
+            break;
+        case OP_TIMINGS:
+            TIMINGS();
+            break;
+        case OP_DEG_BY:
+            DEG_BY(Stack, numberofLine, Line);
+            break;
+        case OP_AT:
+            AT(Stack, numberofLine, Line);
+            break;
+        case OP_COMPOSE:
+            COMPOSE(Stack, numberofLine, Line);
+            break;
+        case OP_MUL_TRUNC:
+            MUL_TRUNC(Stack, numberofLine, Line);
+            break;
+        case OP_EXP_TRUNC:
+            EXP_TRUNC(Stack, numberofLine, Line);
+            break;
+        case OP_SAVE:
+            SAVE(Stack, numberofLine, Line);
+            break;
+        case OP_LOAD:
+            LOAD(Stack, numberofLine, Line);
+            break;
+        case OP_CHECKPOINT:
+            CHECKPOINT(Stack, numberofLine, Line);
+            break;
+        case OP_STORE:
+            STORE(Stack, numberofLine, Line);
+            break;
+        case OP_RECALL:
+            RECALL(Stack, numberofLine, Line);
+            break;
+        default:
+            OutputError(numberofLine, "WRONG COMMAND");
+            break;
+    }
+}
+
+void Command(const line *Line, stack *Stack, size_t numberofLine) {
+    Execute(Decode(Line), Line, Stack, numberofLine);
+}
+
+void PerformLine(const line *Line, stack *Stack, size_t numberofLine) {
+    if (Line->numberofLetters != 0 && Line->letters[0] != '#') {
+        if (IsCommand(Line)) {
+            Command(Line, Stack, numberofLine);
+        } else {
+            savePoly(Line, Stack, numberofLine);
+        }
+    }
+}
+
+void PerformInput(int fd, stack *Stack) {
+    lineReader *Reader = OpenReader(fd);
+    line Line;
+    size_t numberofLine = 0;
+
+    while (true) {
+        if (!LineReady(Reader)) {
+            OutputFlush();
+        }
+        if (!NextLine(Reader, &Line)) {
+            break;
+        }
+        ++numberofLine;
+        PerformLine(&Line, Stack, numberofLine);
+    }
+
+    CloseReader(Reader);
+}
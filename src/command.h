@@ -11,6 +11,41 @@
 #include "stack.h"
 #include "line.h"
 
+/**
+ * These are the commands of the calculator. The commands up to OP_TIMINGS
+ * take no parameter, the ones from OP_DEG_BY on are followed by a space
+ * and a parameter.
+ */
+typedef enum {
+    OP_WRONG,       ///< not a command
+    OP_ZERO,        ///< ZERO
+    OP_IS_COEFF,    ///< IS_COEFF
+    OP_IS_ZERO,     ///< IS_ZERO
+    OP_CLONE,       ///< CLONE
+    OP_ADD,         ///< ADD
+    OP_MUL,         ///< MUL
+    OP_NEG,         ///< NEG
+    OP_SUB,         ///< SUB
+    OP_IS_EQ,       ///< IS_EQ
+    OP_DEG,         ///< DEG
+    OP_PRINT,       ///< PRINT
+    OP_POP,         ///< POP
+    OP_FORCE,       ///< FORCE
+    OP_MEMO,        ///< MEMO
+    OP_STATS,       ///< STATS
+    OP_TIMINGS,     ///< TIMINGS
+    OP_DEG_BY,      ///< DEG_BY
+    OP_AT,          ///< AT
+    OP_COMPOSE,     ///< COMPOSE
+    OP_MUL_TRUNC,   ///< MUL_TRUNC
+    OP_EXP_TRUNC,   ///< EXP_TRUNC
+    OP_SAVE,        ///< SAVE
+    OP_LOAD,        ///< LOAD
+    OP_CHECKPOINT,  ///< CHECKPOINT
+    OP_STORE,       ///< STORE
+    OP_RECALL       ///< RECALL
+} opcode;
+
 /**
  * The function inserts a polynomial equal to zero at the top of the stack.
  * @param[out] Stack : stack
@@ -114,6 +149,16 @@ void DEG_BY(const stack *Stack, size_t numberofLine, const line *Line);
  */
 void AT(stack *Stack, size_t numberofLine, const line *Line);
 
+/**
+ * The function reads the point of the command AT from the line.
+ * Prints an error message in case of a wrong point.
+ * @param[in] Line : line
+ * @param[in] numberofLine : number of line
+ * @param[out] x : point, set only if it is correct
+ * @return Is the point correct?
+ */
+bool AtValue(const line *Line, size_t numberofLine, poly_coeff_t *x);
+
 /**
  * The function prints the polynomial at the top of the stack.
  * Prints an error message in case of an empty stack.
@@ -130,6 +175,36 @@ void PRINT(const stack *Stack, size_t numberofLine);
  */
 void POP(stack *Stack, size_t numberofLine);
 
+/**
+ * The function forces the evaluation of the whole stack in the lazy mode,
+ * see lazy.h. All the other modes evaluate the commands at once,
+ * so there it does nothing.
+ * @param[in] Stack : stack
+ */
+void FORCE(const stack *Stack);
+
+/**
+ * The function prints the numbers of the operations found in the cache
+ * of results and of the ones performed, see polyMemo.h.
+ */
+void MEMO(void);
+
+/**
+ * The function prints the sizes of the polynomial at the top of the stack,
+ * see PolyMeasure, and the memory counters of the polynomial library,
+ * see PolyGetMemoryCounters, which are zero unless the option "--stats" is on.
+ * Prints an error message in case of an empty stack.
+ * @param[in] Stack : stack
+ * @param[in] numberofLine : number of line
+ */
+void STATS(const stack *Stack, size_t numberofLine);
+
+/**
+ * The function prints the percentiles of the durations of every kind of lines,
+ * see StatsTimings, if the option "--timings" is on.
+ */
+void TIMINGS(void);
+
 /**
  * The function loads the size of an array of polynomials and if no error occurs,
  * removes the appropriate number of polynomials from the stack and puts the fold result on top.
@@ -140,4 +215,141 @@ void POP(stack *Stack, size_t numberofLine);
  */
 void COMPOSE(stack *Stack, size_t numberofLine, const line *Line);
 
+/**
+ * The function multiplies the two polynomials from the top of the stack,
+ * removes them and puts their product truncated to the given total degree
+ * at the top of the stack.
+ * Prints an error message in case of too few polynomials or a wrong degree bound.
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void MUL_TRUNC(stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function raises the polynomial at the top of the stack to the given power,
+ * keeping only the monomials up to the given total degree, and replaces it with the result.
+ * Prints an error message in case of an empty stack or wrong parameters.
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void EXP_TRUNC(stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function writes the polynomial at the top of the stack to the binary file
+ * named in the line, see polyFile.h.
+ * Prints an error message in case of an empty stack, a missing file name
+ * or a failed write.
+ * @param[in] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void SAVE(const stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function reads a polynomial from the binary file named in the line
+ * and puts it at the top of the stack.
+ * Prints an error message in case of a missing file name or a wrong file.
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void LOAD(stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function writes the whole stack, from the bottom to the top, to the binary
+ * checkpoint file named in the line, see polyFile.h. The file is written under
+ * a temporary name and renamed once it is complete, so an old checkpoint
+ * is never left half overwritten.
+ * Prints an error message in case of a missing file name or a failed write.
+ * @param[in] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void CHECKPOINT(const stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function puts the polynomial at the top of the stack into the register
+ * named in the line, without copying it, see registers.h.
+ * The polynomial stays on the stack.
+ * Prints an error message in case of an empty stack or a missing name.
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void STORE(stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function puts the polynomial from the register named in the line
+ * at the top of the stack, without copying it.
+ * Prints an error message in case of a missing name or an empty register.
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ * @param[in] Line : line
+ */
+void RECALL(stack *Stack, size_t numberofLine, const line *Line);
+
+/**
+ * The function puts the polynomials from a checkpoint file on the stack,
+ * in the order they had when the checkpoint was written.
+ * @param[in,out] Stack : stack
+ * @param[in] name : name of the file
+ * @return Has the checkpoint been read?
+ */
+bool RestoreStack(stack *Stack, const char *name);
+
+/**
+ * The function checks if the line is a command, that is if it starts with a letter.
+ * Other non-empty lines are polynomials.
+ * @param[in] Line : non-empty line
+ * @return Is the line a command?
+ */
+bool IsCommand(const line *Line);
+
+/**
+ * The function recognizes the command in the line. The name of the command,
+ * up to the first space, is read once and a switch on its first letter
+ * leaves at most three names to compare.
+ * @param[in] Line : non-empty line starting with a letter
+ * @return command, OP_WRONG if the line is not a correct command name
+ */
+opcode Decode(const line *Line);
+
+/**
+ * The function performs the command, the parameter is read from the line.
+ * Prints an error message if the command is OP_WRONG.
+ * @param[in] op : command
+ * @param[in] Line : line
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ */
+void Execute(opcode op, const line *Line, stack *Stack, size_t numberofLine);
+
+/**
+ * The function recognizes the command in the line and performs it.
+ * Prints an error message if the command is wrong.
+ * @param[in] Line : line
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ */
+void Command(const line *Line, stack *Stack, size_t numberofLine);
+
+/**
+ * The function performs the line of the input: the command or the polynomial,
+ * which is put on the stack. Empty lines and lines starting with "#" are ignored.
+ * @param[in] Line : line
+ * @param[in,out] Stack : stack
+ * @param[in] numberofLine : number of line
+ */
+void PerformLine(const line *Line, stack *Stack, size_t numberofLine);
+
+/**
+ * The function reads the lines from the file descriptor and performs them.
+ * The output is written out whenever the next line has to be waited for.
+ * @param[in] fd : file descriptor
+ * @param[in,out] Stack : stack
+ */
+void PerformInput(int fd, stack *Stack);
+
 #endif /* __COMMAND_H__ */
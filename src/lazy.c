@@ -0,0 +1,625 @@
+/** @file
+  Implementation of the lazy evaluation of the calculator.
+  The expressions form a graph of nodes with counted references. A node
+  is evaluated in place, so a node shared by CLONE is computed only once.
+  The evaluation fuses the operations: a chain of additions and subtractions
+  is one node summed by a single k-way merge of its terms, and AT of a sum
+  or a product is moved down to the operands, so they are evaluated
+  at the point before they are added or multiplied.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "lazy.h"
+#include "mallocSafe.h"
+#include "output.h"
+#include "polyMemo.h"
+#include "reclaim.h"
+#include <string.h>
+
+/**
+ * These are the kinds of nodes.
+ */
+typedef enum {
+    NODE_POLY,     ///< evaluated polynomial
+    NODE_SUM,      ///< sum of the terms
+    NODE_PRODUCT,  ///< product of the two terms
+    NODE_AT        ///< value of the term at the point
+} kind;
+
+/**
+ * This is the operand of a node.
+ */
+typedef struct {
+    node *Node;     ///< operand
+    bool negative;  ///< is the operand subtracted?
+} term;
+
+struct node {
+    kind Kind;        ///< kind of node
+    size_t refs;      ///< number of references from the stack and from other nodes
+    Poly p;           ///< polynomial, for NODE_POLY
+    term *terms;      ///< array of operands
+    size_t count;     ///< number of operands
+    size_t room;      ///< size of the array of operands
+    bool negated;     ///< is the sum negated, for NODE_SUM
+    poly_coeff_t x;   ///< point, for NODE_AT
+};
+
+/**
+ * This is the stack of nodes used to traverse the graph without recursion.
+ */
+typedef struct {
+    node **Array;     ///< array of nodes
+    size_t size;      ///< number of nodes
+    size_t capacity;  ///< size of the array
+} nodeStack;
+
+/**
+ * A simple function that returns approximately twice the value.
+ * @param[in] n : integer
+ * @return result
+ */
+static size_t more(size_t n) {
+    return 2 * n + 4;
+}
+
+/**
+ * The function puts a node on the stack of nodes.
+ * @param[in,out] s : stack of nodes
+ * @param[in] n : node
+ */
+static void nodePush(nodeStack *s, node *n) {
+    if (s->size == s->capacity) {
+        s->capacity = more(s->capacity);
+        s->Array = (node **) realloc(s->Array, s->capacity * sizeof(node *));
+        if (s->Array == NULL) {
+            exit(1);
+        }
+    }
+    s->Array[s->size++] = n;
+}
+
+/**
+ * The function creates a node without operands.
+ * @param[in] Kind : kind of node
+ * @return node
+ */
+static node *newNode(kind Kind) {
+    node *n = (node *) mallocSafe(sizeof(node));
+    *n = (node) {.Kind = Kind, .refs = 1, .p = PolyZero(), .terms = NULL,
+                 .count = 0, .room = 0, .negated = false, .x = 0};
+
+    return n;
+}
+
+/**
+ * The function appends an operand to the node, taking over its reference.
+ * @param[in,out] n : node
+ * @param[in] operand : operand
+ * @param[in] negative : is the operand subtracted?
+ */
+static void addTerm(node *n, node *operand, bool negative) {
+    if (n->count == n->room) {
+        n->room = more(n->room);
+        n->terms = (term *) realloc(n->terms, n->room * sizeof(term));
+        if (n->terms == NULL) {
+            exit(1);
+        }
+    }
+    n->terms[n->count++] = (term) {.Node = operand, .negative = negative};
+}
+
+/**
+ * The function drops a reference to the node. Nodes without references
+ * are removed together with their polynomials, without being evaluated.
+ * @param[in] n : node
+ */
+static void release(node *n) {
+    nodeStack s = {.Array = NULL, .size = 0, .capacity = 0};
+    nodePush(&s, n);
+
+    while (s.size > 0) {
+        node *t = s.Array[--s.size];
+        if (--t->refs == 0) {
+            for (size_t i = 0; i < t->count; ++i) {
+                nodePush(&s, t->terms[i].Node);
+            }
+            PolyDestroyDeferred(&(t->p));
+            free(t->terms);
+            free(t);
+        }
+    }
+
+    free(s.Array);
+}
+
+/**
+ * The function checks if the node is a sum which can be changed in place.
+ * @param[in] n : node
+ * @return Is it a sum referenced only once?
+ */
+static bool ownSum(const node *n) {
+    return n->Kind == NODE_SUM && n->refs == 1;
+}
+
+/**
+ * The function builds the sum of two operands, taking over their references.
+ * The operands being sums are flattened: the smaller one is appended
+ * to the larger one, so a chain of additions costs linear time.
+ * @param[in] a : operand
+ * @param[in] negativeA : is @p a subtracted?
+ * @param[in] b : operand
+ * @param[in] negativeB : is @p b subtracted?
+ * @return sum
+ */
+static node *sum(node *a, bool negativeA, node *b, bool negativeB) {
+    if (!ownSum(b) || (ownSum(a) && a->count > b->count)) {
+        node *n = a;
+        a = b;
+        b = n;
+        bool negative = negativeA;
+        negativeA = negativeB;
+        negativeB = negative;
+    }
+
+    node *r;
+    if (ownSum(b)) {
+        r = b;
+        r->negated = r->negated != negativeB;
+    } else {
+        r = newNode(NODE_SUM);
+        addTerm(r, b, negativeB);
+    }
+
+    if (ownSum(a)) {
+        for (size_t i = 0; i < a->count; ++i) {
+            addTerm(r, a->terms[i].Node,
+                    (a->terms[i].negative != a->negated) != (negativeA != r->negated));
+        }
+        free(a->terms);
+        free(a);
+    } else {
+        addTerm(r, a, negativeA != r->negated);
+    }
+
+    return r;
+}
+
+/**
+ * The function moves AT down to the operands of a sum or a product
+ * referenced only by this node: the node becomes the sum or the product
+ * of the values of the operands at the point. With the cache on nothing is
+ * moved, so MEMO counts the same operations as without the lazy mode.
+ * @param[in,out] n : node of kind NODE_AT
+ */
+static void distribute(node *n) {
+    node *c = n->terms[0].Node;
+    if (PolyMemoIsOn() || c->refs != 1 || (c->Kind != NODE_SUM && c->Kind != NODE_PRODUCT)) {
+        return;
+    }
+
+    for (size_t i = 0; i < c->count; ++i) {
+        node *t = newNode(NODE_AT);
+        t->x = n->x;
+        addTerm(t, c->terms[i].Node, false);
+        c->terms[i].Node = t;
+    }
+
+    free(n->terms);
+    n->Kind = c->Kind;
+    n->terms = c->terms;
+    n->count = c->count;
+    n->room = c->room;
+    n->negated = c->negated;
+    free(c);
+}
+
+/**
+ * The function takes the polynomial of an evaluated operand,
+ * moving it out of the node if the node has no other references.
+ * @param[in,out] t : operand
+ * @param[in] negative : should the polynomial be negated?
+ * @return polynomial
+ */
+static Poly takeValue(term *t, bool negative) {
+    node *n = t->Node;
+    Poly v;
+    if (n->refs == 1) {
+        v = n->p;
+        n->p = PolyZero();
+        PolyUnshare(&v);
+    } else {
+        v = PolyClone(&(n->p));
+    }
+
+    if (negative) {
+        Poly w = PolyNeg(&v);
+        PolyDestroy(&v);
+        v = w;
+    }
+
+    return v;
+}
+
+/**
+ * The function compares the monomials at the heads of two runs.
+ * @param[in] runs : runs of monomials
+ * @param[in] heads : positions of the heads of the runs
+ * @param[in] i : run
+ * @param[in] j : run
+ * @return Does the head of @p i have a smaller exponent than the head of @p j?
+ */
+static inline bool before(const Poly runs[], const size_t heads[], size_t i, size_t j) {
+    return PolyGetExp(&(runs[i]), heads[i]) < PolyGetExp(&(runs[j]), heads[j]);
+}
+
+/**
+ * The function restores the heap of runs below the given position.
+ * @param[in,out] heap : heap of runs
+ * @param[in] size : number of runs in the heap
+ * @param[in] runs : runs of monomials
+ * @param[in] heads : positions of the heads of the runs
+ * @param[in] i : position in the heap
+ */
+static void siftDown(size_t heap[], size_t size, const Poly runs[],
+                     const size_t heads[], size_t i) {
+    while (2 * i + 1 < size) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < size && before(runs, heads, heap[child + 1], heap[child])) {
+            ++child;
+        }
+        if (!before(runs, heads, heap[child], heap[i])) {
+            return;
+        }
+        size_t t = heap[i];
+        heap[i] = heap[child];
+        heap[child] = t;
+        i = child;
+    }
+}
+
+/**
+ * The function adds the polynomials by a k-way merge of their monomials,
+ * which are already sorted, and takes over the polynomials.
+ * @param[in] count : number of polynomials
+ * @param[in] runs : polynomials
+ * @return sum
+ */
+static Poly merge(size_t count, Poly runs[]) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += PolyIsCoeff(&(runs[i])) ? 1 : PolyLength(&(runs[i]));
+    }
+
+    // The constants are the monomials of the exponent 0, so they go first
+    // and only the other polynomials are merged.
+    Mono *monos = (Mono *) PolyMalloc(total * sizeof(Mono));
+    size_t k = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (PolyIsCoeff(&(runs[i]))) {
+            monos[k++] = (Mono) {.p = runs[i], .exp = 0};
+        } else {
+            runs[n++] = runs[i];
+        }
+    }
+
+    if (n > 0) {
+        size_t *heads = (size_t *) mallocSafe(n * sizeof(size_t));
+        size_t *heap = (size_t *) mallocSafe(n * sizeof(size_t));
+        for (size_t i = 0; i < n; ++i) {
+            heads[i] = 0;
+            heap[i] = i;
+        }
+        for (size_t i = n / 2; i-- > 0;) {
+            siftDown(heap, n, runs, heads, i);
+        }
+
+        size_t size = n;
+        for (; k < total; ++k) {
+            size_t i = heap[0];
+            monos[k] = PolyGetMono(&(runs[i]), heads[i]++);
+            if (heads[i] == PolyLength(&(runs[i]))) {
+                heap[0] = heap[--size];
+            }
+            siftDown(heap, size, runs, heads, 0);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            PolyFreeMonos(&(runs[i]));
+        }
+        free(heads);
+        free(heap);
+    }
+
+    return PolyOwnNormalMonos(total, monos);
+}
+
+/**
+ * The function computes the node whose operands are all evaluated
+ * and turns it into an evaluated polynomial.
+ * @param[in,out] n : node
+ */
+static void compute(node *n) {
+    Poly r;
+
+    switch (n->Kind) {
+        case NODE_SUM:
+            if (n->count == 1) {
+                r = takeValue(&(n->terms[0]), n->terms[0].negative != n->negated);
+            } else {
+                Poly *runs = (Poly *) mallocSafe(n->count * sizeof(Poly));
+                for (size_t i = 0; i < n->count; ++i) {
+                    runs[i] = takeValue(&(n->terms[i]), n->terms[i].negative != n->negated);
+                }
+                r = merge(n->count, runs);
+                free(runs);
+            }
+            break;
+        case NODE_PRODUCT:
+            r = PolyMemoMul(&(n->terms[0].Node->p), &(n->terms[1].Node->p));
+            break;
+        default:
+            r = PolyMemoAt(&(n->terms[0].Node->p), n->x);
+            break;
+    }
+
+    for (size_t i = 0; i < n->count; ++i) {
+        release(n->terms[i].Node);
+    }
+    free(n->terms);
+    *n = (node) {.Kind = NODE_POLY, .refs = n->refs, .p = r, .terms = NULL,
+                 .count = 0, .room = 0, .negated = false, .x = 0};
+}
+
+/**
+ * The function evaluates the node, the operands before the operations.
+ * @param[in,out] root : node
+ */
+static void evaluate(node *root) {
+    nodeStack s = {.Array = NULL, .size = 0, .capacity = 0};
+    nodePush(&s, root);
+
+    while (s.size > 0) {
+        node *n = s.Array[s.size - 1];
+        if (n->Kind == NODE_POLY) {
+            --s.size;
+            continue;
+        }
+        if (n->Kind == NODE_AT) {
+            distribute(n);
+        }
+
+        bool ready = true;
+        for (size_t i = 0; i < n->count; ++i) {
+            if (n->terms[i].Node->Kind != NODE_POLY) {
+                nodePush(&s, n->terms[i].Node);
+                ready = false;
+            }
+        }
+        if (ready) {
+            --s.size;
+            compute(n);
+        }
+    }
+
+    free(s.Array);
+}
+
+/**
+ * The function makes room for the expressions of all the polynomials on the stack.
+ * @param[in,out] Lazy : lazy stack
+ */
+static void fitNodes(lazyStack *Lazy) {
+    if (Lazy->sizeofNodes < Lazy->Stack->top) {
+        size_t size = Lazy->sizeofNodes;
+        Lazy->sizeofNodes = more(Lazy->Stack->top);
+        Lazy->Nodes = (node **) realloc(Lazy->Nodes, Lazy->sizeofNodes * sizeof(node *));
+        if (Lazy->Nodes == NULL) {
+            exit(1);
+        }
+        memset(Lazy->Nodes + size, 0, (Lazy->sizeofNodes - size) * sizeof(node *));
+    }
+}
+
+/**
+ * The function evaluates the expression at the given position of the stack.
+ * @param[in,out] Lazy : lazy stack
+ * @param[in] i : position
+ */
+static void force(lazyStack *Lazy, size_t i) {
+    node *n = Lazy->Nodes[i];
+    if (n == NULL) {
+        return;
+    }
+
+    evaluate(n);
+    if (n->refs == 1) {
+        Lazy->Stack->Array[i] = n->p;
+        n->p = PolyZero();
+    } else {
+        Lazy->Stack->Array[i] = PolyClone(&(n->p));
+    }
+    release(n);
+    Lazy->Nodes[i] = NULL;
+}
+
+/**
+ * The function returns the node at the given position of the stack,
+ * turning an evaluated polynomial into a node.
+ * @param[in,out] Lazy : lazy stack
+ * @param[in] i : position
+ * @return node
+ */
+static node *nodeAt(lazyStack *Lazy, size_t i) {
+    if (Lazy->Nodes[i] == NULL) {
+        node *n = newNode(NODE_POLY);
+        n->p = Lazy->Stack->Array[i];
+        Lazy->Stack->Array[i] = PolyZero();
+        Lazy->Nodes[i] = n;
+    }
+
+    return Lazy->Nodes[i];
+}
+
+/**
+ * The function pops the node from the top of the stack.
+ * @param[in,out] Lazy : lazy stack
+ * @return node
+ */
+static node *popNode(lazyStack *Lazy) {
+    size_t i = Lazy->Stack->top - 1;
+    node *n = nodeAt(Lazy, i);
+    Lazy->Nodes[i] = NULL;
+    Pop(Lazy->Stack);
+
+    return n;
+}
+
+/**
+ * The function puts the node on the stack.
+ * @param[in,out] Lazy : lazy stack
+ * @param[in] n : node
+ */
+static void pushNode(lazyStack *Lazy, node *n) {
+    Push(Lazy->Stack, PolyZero());
+    fitNodes(Lazy);
+    Lazy->Nodes[Lazy->Stack->top - 1] = n;
+}
+
+/**
+ * The function gives the number of polynomials from the top of the stack
+ * read by the command performed without the lazy mode. MEMO forces the whole
+ * stack, so its counters include the operations which are still pending.
+ * @param[in] op : command
+ * @param[in] top : number of polynomials on the stack
+ * @return number of polynomials
+ */
+static size_t needed(opcode op, size_t top) {
+    switch (op) {
+        case OP_WRONG:
+        case OP_ZERO:
+        case OP_LOAD:
+        case OP_TIMINGS:
+        case OP_RECALL:
+            return 0;
+        case OP_IS_COEFF:
+        case OP_IS_ZERO:
+        case OP_DEG:
+        case OP_PRINT:
+        case OP_STATS:
+        case OP_DEG_BY:
+        case OP_EXP_TRUNC:
+        case OP_SAVE:
+        case OP_STORE:
+            return top < 1 ? top : 1;
+        case OP_IS_EQ:
+        case OP_MUL_TRUNC:
+            return top < 2 ? top : 2;
+        default:
+            return top;
+    }
+}
+
+lazyStack LazyInit(stack *Stack) {
+    lazyStack Lazy = {.Stack = Stack, .Nodes = NULL, .sizeofNodes = 0};
+    fitNodes(&Lazy);
+
+    return Lazy;
+}
+
+void LazyPush(lazyStack *Lazy, Poly p) {
+    Push(Lazy->Stack, p);
+    fitNodes(Lazy);
+}
+
+void LazyExecute(lazyStack *Lazy, opcode op, const line *Line, size_t numberofLine) {
+    stack *Stack = Lazy->Stack;
+    poly_coeff_t x;
+
+    switch (op) {
+        case OP_CLONE:
+            if (Empty(Stack)) {
+                OutputError(numberofLine, "STACK UNDERFLOW");
+            } else {
+                node *n = nodeAt(Lazy, Stack->top - 1);
+                ++n->refs;
+                pushNode(Lazy, n);
+            }
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+            if (Stack->top < 2) {
+                OutputError(numberofLine, "STACK UNDERFLOW");
+            } else {
+                node *p = popNode(Lazy);
+                node *q = popNode(Lazy);
+                if (op == OP_MUL) {
+                    node *r = newNode(NODE_PRODUCT);
+                    addTerm(r, p, false);
+                    addTerm(r, q, false);
+                    pushNode(Lazy, r);
+                } else {
+                    pushNode(Lazy, sum(p, false, q, op == OP_SUB));
+                }
+            }
+            break;
+        case OP_NEG:
+            if (Empty(Stack)) {
+                OutputError(numberofLine, "STACK UNDERFLOW");
+            } else {
+                node *p = popNode(Lazy);
+                if (ownSum(p)) {
+                    p->negated = !p->negated;
+                } else {
+                    node *r = newNode(NODE_SUM);
+                    addTerm(r, p, true);
+                    p = r;
+                }
+                pushNode(Lazy, p);
+            }
+            break;
+        case OP_AT:
+            if (AtValue(Line, numberofLine, &x)) {
+                if (Empty(Stack)) {
+                    OutputError(numberofLine, "STACK UNDERFLOW");
+                } else {
+                    node *r = newNode(NODE_AT);
+                    r->x = x;
+                    addTerm(r, popNode(Lazy), false);
+                    pushNode(Lazy, r);
+                }
+            }
+            break;
+        case OP_POP:
+            if (Empty(Stack)) {
+                OutputError(numberofLine, "STACK UNDERFLOW");
+            } else {
+                release(popNode(Lazy));
+            }
+            break;
+        default: {
+            size_t top = Stack->top;
+            for (size_t i = top - needed(op, top); i < top; ++i) {
+                force(Lazy, i);
+            }
+            Execute(op, Line, Stack, numberofLine);
+            fitNodes(Lazy);
+            break;
+        }
+    }
+}
+
+void LazyClear(lazyStack *Lazy) {
+    for (size_t i = 0; i < Lazy->Stack->top; ++i) {
+        if (Lazy->Nodes[i] != NULL) {
+            release(Lazy->Nodes[i]);
+        }
+    }
+    free(Lazy->Nodes);
+    Lazy->Nodes = NULL;
+    Lazy->sizeofNodes = 0;
+}
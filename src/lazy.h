@@ -0,0 +1,64 @@
+/** @file
+  Interface of the lazy evaluation of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __LAZY_H__
+#define __LAZY_H__
+
+#include "command.h"
+
+/**
+ * This is the node of an expression not evaluated yet.
+ */
+typedef struct node node;
+
+/**
+ * This is the stack of the lazy mode. The commands ADD, SUB, MUL, NEG and AT
+ * do not compute their results, they put the expressions on the stack instead,
+ * and CLONE shares the expression between both places. An expression is
+ * evaluated only when its value is needed: by PRINT, IS_*, DEG*, by any other
+ * command reading the polynomials or by FORCE, which evaluates the whole stack.
+ * Expressions popped before their values are needed are never evaluated.
+ */
+typedef struct {
+    stack *Stack;        ///< evaluated polynomials, zeros in place of the expressions
+    node **Nodes;        ///< expressions on the stack, NULL for evaluated polynomials
+    size_t sizeofNodes;  ///< size of the array of expressions
+} lazyStack;
+
+/**
+ * The function creates the lazy stack over the stack of polynomials.
+ * The polynomials already on the stack are evaluated.
+ * @param[in] Stack : stack
+ * @return lazy stack
+ */
+lazyStack LazyInit(stack *Stack);
+
+/**
+ * The function puts an evaluated polynomial on the stack.
+ * @param[in,out] Lazy : lazy stack
+ * @param[in] p : polynomial
+ */
+void LazyPush(lazyStack *Lazy, Poly p);
+
+/**
+ * The function performs the command in the lazy mode. The output and
+ * the error messages are the same as without the lazy mode.
+ * @param[in,out] Lazy : lazy stack
+ * @param[in] op : command
+ * @param[in] Line : line
+ * @param[in] numberofLine : number of line
+ */
+void LazyExecute(lazyStack *Lazy, opcode op, const line *Line, size_t numberofLine);
+
+/**
+ * The function removes the expressions not evaluated yet, leaving
+ * zero polynomials in their places on the stack.
+ * @param[in,out] Lazy : lazy stack
+ */
+void LazyClear(lazyStack *Lazy);
+
+#endif /* __LAZY_H__ */
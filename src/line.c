@@ -1,24 +1,24 @@
 /** @file
-  The file contains an implementation of the row creation and augmentation functionality
+  The file contains an implementation of the input reader
 
   @author Maja Wiśniewska <mw429666.students.mimuw.edu.pl>
   @date 2021
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "line.h"
 #include "mallocSafe.h"
+#include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-line *createaLine(void) {
-    line *Line = (line *) mallocSafe(sizeof(line));
-
-    Line->letters = (char *) mallocSafe(sizeof(char));
-    Line->letters[0] = 0;
-    Line->sizeofArray = 1;
-    Line->numberofLetters = 0;
-
-    return Line;
-}
+/**
+ * The initial size of the block buffer.
+ */
+#define BLOCK_SIZE (1 << 20)
 
 /**
  * A simple function that returns approximately twice the value.
@@ -31,13 +31,127 @@ static size_t more(size_t n) {
     return result;
 }
 
-void enlargeLine(line *Line) {
-    Line->sizeofArray = more(Line->sizeofArray);
-    Line->letters = (char *) realloc(Line->letters,
-                                     Line->sizeofArray * sizeof(char));
-    if (Line->letters == NULL) {
-        exit(1);
+lineReader *OpenReader(int fd) {
+    lineReader *Reader = (lineReader *) mallocSafe(sizeof(lineReader));
+    struct stat info;
+
+    Reader->fd = fd;
+    Reader->size = 0;
+    Reader->position = 0;
+    Reader->end = false;
+    Reader->mapped = false;
+    Reader->lastLine = NULL;
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, (size_t) info.st_size, POSIX_MADV_SEQUENTIAL);
+            Reader->buffer = (char *) map;
+            Reader->size = (size_t) info.st_size;
+            Reader->capacity = Reader->size;
+            Reader->mapped = true;
+            Reader->end = true;
+        }
+    }
+
+    if (!Reader->mapped) {
+        Reader->capacity = BLOCK_SIZE;
+        Reader->buffer = (char *) mallocSafe(Reader->capacity + 1);
+    }
+
+    return Reader;
+}
+
+/**
+ * The function reads the next block of the input into the buffer. The unread
+ * part of the buffer is moved to its beginning and the buffer is enlarged
+ * if it is full. The byte after the data is always zero.
+ * @param[in,out] Reader : reader
+ */
+static void readBlock(lineReader *Reader) {
+    size_t rest = Reader->size - Reader->position;
+
+    memmove(Reader->buffer, Reader->buffer + Reader->position, rest);
+    Reader->size = rest;
+    Reader->position = 0;
+
+    if (Reader->size == Reader->capacity) {
+        Reader->capacity = more(Reader->capacity);
+        Reader->buffer = (char *) realloc(Reader->buffer, Reader->capacity + 1);
+        if (Reader->buffer == NULL) {
+            exit(1);
+        }
+    }
+
+    ssize_t count;
+    do {
+        count = read(Reader->fd, Reader->buffer + Reader->size, Reader->capacity - Reader->size);
+    } while (count < 0 && errno == EINTR);
+
+    if (count <= 0) {
+        Reader->end = true;
+    } else {
+        Reader->size += (size_t) count;
+    }
+    Reader->buffer[Reader->size] = 0;
+}
+
+bool LineReady(const lineReader *Reader) {
+    return Reader->end || memchr(Reader->buffer + Reader->position, '\n',
+                                 Reader->size - Reader->position) != NULL;
+}
+
+bool NextLine(lineReader *Reader, line *Line) {
+    char *newline = NULL;
+    size_t checked = 0;
+
+    // Only the bytes read by the last block are searched, long lines stay linear.
+    while (true) {
+        newline = memchr(Reader->buffer + Reader->position + checked, '\n',
+                         Reader->size - Reader->position - checked);
+        if (newline != NULL || Reader->end) {
+            break;
+        }
+        checked = Reader->size - Reader->position;
+        readBlock(Reader);
+    }
+
+    if (newline == NULL && Reader->position == Reader->size) {
+        return false;
     }
-    memset(Line->letters + Line->numberofLetters, 0,
-           Line->sizeofArray - Line->numberofLetters);
+
+    Line->letters = Reader->buffer + Reader->position;
+    if (newline != NULL) {
+        Line->numberofLetters = (size_t) (newline - Line->letters);
+        Reader->position += Line->numberofLetters + 1;
+    } else {
+        Line->numberofLetters = Reader->size - Reader->position;
+        Reader->position = Reader->size;
+        if (Reader->mapped) {
+            Reader->lastLine = (char *) mallocSafe(Line->numberofLetters + 1);
+            memcpy(Reader->lastLine, Line->letters, Line->numberofLetters);
+            Reader->lastLine[Line->numberofLetters] = 0;
+            Line->letters = Reader->lastLine;
+        }
+    }
+
+    return true;
+}
+
+void CloseReader(lineReader *Reader) {
+    if (Reader->mapped) {
+        munmap(Reader->buffer, Reader->size);
+    } else {
+        free(Reader->buffer);
+    }
+    free(Reader->lastLine);
+    free(Reader);
+}
+
+bool LineRestIs(const line *Line, size_t start, const char *word) {
+    size_t length = strlen(word);
+
+    return start <= Line->numberofLetters &&
+           Line->numberofLetters - start == length &&
+           memcmp(Line->letters + start, word, length) == 0;
 }
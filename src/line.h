@@ -1,5 +1,6 @@
 /** @file
-  The file contains the row structure and the row creation and magnification interface
+  The file contains the line structure and the interface of the input reader
+  that splits the input into lines
 
   @author Maja Wiśniewska <mw429666.students.mimuw.edu.pl>
   @date 2021
@@ -8,27 +9,74 @@
 #ifndef __LINE_H__
 #define __LINE_H__
 
+#include <stdbool.h>
 #include <stdio.h>
 
 /**
  * This is the structure that holds the line of entry.
+ * The line is a slice of the reader's buffer, it is not terminated with zero.
+ * The character after the last letter is always a newline or a zero,
+ * so functions like strtol stop on it.
  */
 typedef struct{
-    char *letters;           ///< array of characters
+    const char *letters;     ///< array of characters
     size_t numberofLetters;  ///< number of characters
-    size_t sizeofArray;      ///< array length
 } line;
 
 /**
- * The function creates an empty line.
- * @return line
+ * This is the structure that reads the input and splits it into lines.
+ * A regular file is mapped into memory, any other input is read
+ * in large blocks into a reusable buffer.
  */
-line *createaLine(void);
+typedef struct{
+    int fd;             ///< file descriptor
+    char *buffer;       ///< mapped file or block buffer
+    size_t size;        ///< number of bytes in the buffer
+    size_t capacity;    ///< size of the block buffer
+    size_t position;    ///< index of the beginning of the next line
+    bool mapped;        ///< Is the buffer a mapped file?
+    bool end;           ///< Has the whole input been read?
+    char *lastLine;     ///< copy of the last line of a mapped file not ended with a newline
+} lineReader;
+
+/**
+ * The function creates a reader of the given file descriptor.
+ * @param[in] fd : file descriptor
+ * @return reader
+ */
+lineReader *OpenReader(int fd);
+
+/**
+ * The function gives the next line of the input without the newline character.
+ * The line stays valid until the next call.
+ * @param[in,out] Reader : reader
+ * @param[out] Line : line
+ * @return Was there a line left?
+ */
+bool NextLine(lineReader *Reader, line *Line);
+
+/**
+ * The function checks if the next line is already in the buffer,
+ * so NextLine gives it without waiting for the input.
+ * @param[in] Reader : reader
+ * @return Is the next line in the buffer?
+ */
+bool LineReady(const lineReader *Reader);
+
+/**
+ * The function frees the reader. It does not close the file descriptor.
+ * @param[in,out] Reader : reader
+ */
+void CloseReader(lineReader *Reader);
 
 /**
- * The function enlarges the row.
- * @param[in,out] Line : line
+ * The function checks if the part of the line from the index @p start
+ * to the end of the line is exactly the given word.
+ * @param[in] Line : line
+ * @param[in] start : starting index
+ * @param[in] word : word
+ * @return Is the rest of the line equal to the word?
  */
-void enlargeLine(line *Line);
+bool LineRestIs(const line *Line, size_t start, const char *word);
 
 #endif /* __LINE_H__ */
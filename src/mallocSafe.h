@@ -10,6 +10,13 @@
 
 #include <stdlib.h>
 
+/**
+ * The function counts the memory allocated by mallocSafe,
+ * if the statistics are on, see stats.h.
+ * @param[in] pointer : allocated memory
+ */
+void SafeCount(void *pointer);
+
 /**
  * The function will allocate @p size bytes, if possible.
  * Otherwise it terminates the program with code 1 emergency.
@@ -21,6 +28,7 @@ static inline void *mallocSafe(size_t size) {
     if (pointer == NULL) {
         exit(1);
     }
+    SafeCount(pointer);
     return pointer;
 }
 
@@ -0,0 +1,442 @@
+/** @file
+  Implementation of the buffered output of the calculator.
+  The standard output of the thread which called OutputStart is collected
+  in one of two static buffers. A full buffer is written with a single call
+  of write, either at once or by the writer thread, which writes one buffer
+  while the other one is being filled. Every other thread writing to the
+  standard output gets an output stream of its own, so the threads never share
+  a buffer. An output stream has a buffer of its own and belongs to a single thread.
+  The own streams are also listed, so the streams of the threads still running
+  are written out at exit by the thread which calls exit.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "output.h"
+#include "polyAlloc.h"
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** The buffers of the output. */
+static char buffers[2][OUTPUT_BUFFER];
+
+/** The buffer being filled. */
+static int active = 0;
+
+/** The number of characters in the buffer being filled. */
+static size_t used = 0;
+
+/** Should the output be written at the end of every line? */
+static bool lineFlush = false;
+
+/** Is the writer thread running? */
+static bool threaded = false;
+
+/** The buffer handed over to the writer thread. */
+static int pendingBuffer;
+
+/** The number of characters handed over to the writer thread. */
+static size_t pendingSize;
+
+/** The semaphore raised when a buffer is handed over to the writer thread. */
+static sem_t full;
+
+/** The semaphore raised when the writer thread has written its buffer. */
+static sem_t empty;
+
+struct outputStream {
+    int fd;                              ///< file descriptor
+    bool lines;                          ///< written out at the end of every line?
+    size_t used;                         ///< number of characters in the buffer
+    pthread_mutex_t lock;                ///< lock of an own stream, see flushOwns
+    struct outputStream *next;           ///< next own stream on the list
+    char buffer[OUTPUT_STREAM_BUFFER];   ///< buffer
+};
+
+/** It marks a thread which writes to the standard output and has no stream for it yet. */
+static outputStream undecided;
+
+/**
+ * The output stream of the calling thread, NULL for the static buffers,
+ * &undecided until it is known.
+ */
+static _Thread_local outputStream *current = &undecided;
+
+/** The stream of the error messages of the calling thread, NULL for the standard error. */
+static _Thread_local outputStream *errors = NULL;
+
+/** Does the calling thread own the static buffers, see OutputStart? */
+static _Thread_local bool starter = false;
+
+/** The stream of the standard output of a thread which does not own the static buffers. */
+static _Thread_local outputStream *own = NULL;
+
+/** Guard of the creation of ownKey. */
+static pthread_once_t ownOnce = PTHREAD_ONCE_INIT;
+
+/** The key whose destructor writes out the own stream of an ending thread. */
+static pthread_key_t ownKey;
+
+/** The list of the own streams of the running threads. */
+static outputStream *owns = NULL;
+
+/** The lock of the list of the own streams. */
+static pthread_mutex_t ownsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The function writes the characters to the file descriptor.
+ * If the output is closed, the characters are dropped.
+ * @param[in] fd : file descriptor
+ * @param[in] letters : array of characters
+ * @param[in] count : number of characters
+ */
+static void writeAll(int fd, const char *letters, size_t count) {
+    while (count > 0) {
+        ssize_t written = write(fd, letters, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        letters += written;
+        count -= (size_t) written;
+    }
+}
+
+/**
+ * The main function of the writer thread.
+ * @param[in] arg : unused
+ * @return NULL
+ */
+static void *writer(void *arg) {
+    (void) arg;
+
+    while (true) {
+        while (sem_wait(&full) != 0) {
+        }
+        writeAll(STDOUT_FILENO, buffers[pendingBuffer], pendingSize);
+        sem_post(&empty);
+    }
+
+    return NULL;
+}
+
+/**
+ * The function writes out the buffer being filled and empties it.
+ * In the asynchronous mode it only waits until the writer thread
+ * has finished the previous buffer.
+ */
+static void handOver(void) {
+    if (used == 0) {
+        return;
+    }
+    if (threaded) {
+        while (sem_wait(&empty) != 0) {
+        }
+        pendingBuffer = active;
+        pendingSize = used;
+        sem_post(&full);
+        active = 1 - active;
+    } else {
+        writeAll(STDOUT_FILENO, buffers[active], used);
+    }
+    used = 0;
+}
+
+void OutputStart(bool async) {
+    starter = true;
+    if (current == &undecided) {
+        current = NULL;
+    }
+    lineFlush = isatty(STDOUT_FILENO);
+    atexit(OutputFlush);
+
+    if (async && sem_init(&full, 0, 0) == 0) {
+        if (sem_init(&empty, 0, 1) == 0) {
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, writer, NULL) == 0) {
+                pthread_detach(thread);
+                threaded = true;
+                return;
+            }
+            sem_destroy(&empty);
+        }
+        sem_destroy(&full);
+    }
+}
+
+/**
+ * The function appends the characters to the output stream,
+ * writing out its buffer when it is full.
+ * @param[in,out] Stream : output stream
+ * @param[in] letters : array of characters
+ * @param[in] count : number of characters
+ */
+static void streamPut(outputStream *Stream, const char *letters, size_t count) {
+    while (count > 0) {
+        if (Stream->used == OUTPUT_STREAM_BUFFER) {
+            writeAll(Stream->fd, Stream->buffer, Stream->used);
+            Stream->used = 0;
+        }
+        size_t part = OUTPUT_STREAM_BUFFER - Stream->used;
+        if (part > count) {
+            part = count;
+        }
+        memcpy(Stream->buffer + Stream->used, letters, part);
+        Stream->used += part;
+        letters += part;
+        count -= part;
+    }
+}
+
+outputStream *OutputOpen(int fd) {
+    outputStream *Stream = (outputStream *) PolyMalloc(sizeof(outputStream));
+    Stream->fd = fd;
+    Stream->lines = false;
+    Stream->used = 0;
+    Stream->next = NULL;
+    pthread_mutex_init(&(Stream->lock), NULL);
+
+    return Stream;
+}
+
+/**
+ * The function gives the output stream of the standard output of the calling thread.
+ * @return NULL for the static buffers, &undecided if the thread has no stream yet
+ */
+static outputStream *standardOutput(void) {
+    return starter ? NULL : own != NULL ? own : &undecided;
+}
+
+void OutputClose(outputStream *Stream) {
+    writeAll(Stream->fd, Stream->buffer, Stream->used);
+    if (current == Stream) {
+        current = standardOutput();
+    }
+    if (errors == Stream) {
+        errors = NULL;
+    }
+    pthread_mutex_destroy(&(Stream->lock));
+    PolyFree(Stream);
+}
+
+void OutputRedirect(outputStream *Stream, outputStream *Errors) {
+    current = Stream != NULL ? Stream : standardOutput();
+    errors = Errors;
+}
+
+/**
+ * The function writes out and frees the own stream of an ending thread.
+ * @param[in] value : own stream
+ */
+static void closeOwn(void *value) {
+    outputStream *Stream = (outputStream *) value;
+
+    pthread_mutex_lock(&ownsLock);
+    outputStream **link = &owns;
+    while (*link != Stream) {
+        link = &((*link)->next);
+    }
+    *link = Stream->next;
+    pthread_mutex_unlock(&ownsLock);
+
+    writeAll(Stream->fd, Stream->buffer, Stream->used);
+    pthread_mutex_destroy(&(Stream->lock));
+    PolyFree(Stream);
+}
+
+/**
+ * The function writes out the own streams of all the threads at exit.
+ * The threads still running never get to closeOwn, and each of them
+ * may be writing to its stream, so the stream is locked meanwhile.
+ */
+static void flushOwns(void) {
+    pthread_mutex_lock(&ownsLock);
+    for (outputStream *Stream = owns; Stream != NULL; Stream = Stream->next) {
+        pthread_mutex_lock(&(Stream->lock));
+        writeAll(Stream->fd, Stream->buffer, Stream->used);
+        Stream->used = 0;
+        pthread_mutex_unlock(&(Stream->lock));
+    }
+    pthread_mutex_unlock(&ownsLock);
+}
+
+/**
+ * The function prepares the writing out of the own streams
+ * when their threads end and at exit.
+ */
+static void prepareOwn(void) {
+    if (pthread_key_create(&ownKey, closeOwn) != 0) {
+        exit(1);
+    }
+    atexit(OutputFlush);
+    atexit(flushOwns);
+}
+
+/**
+ * The function locks the stream of the calling thread if it is its own
+ * stream, which the thread calling exit may write out, see flushOwns.
+ * @param[in,out] Stream : output stream
+ */
+static void lockOwn(outputStream *Stream) {
+    if (Stream == own) {
+        pthread_mutex_lock(&(Stream->lock));
+    }
+}
+
+/**
+ * The function unlocks the stream locked by lockOwn.
+ * @param[in,out] Stream : output stream
+ */
+static void unlockOwn(outputStream *Stream) {
+    if (Stream == own) {
+        pthread_mutex_unlock(&(Stream->lock));
+    }
+}
+
+/**
+ * The function gives the stream the calling thread writes its output to,
+ * which is not NULL. A thread which does not own the static buffers gets
+ * its own stream of the standard output when it writes for the first time.
+ * The stream outlives the tasks of PolyRun, see PolyKeep.
+ * @return output stream
+ */
+static outputStream *target(void) {
+    if (current == &undecided) {
+        pthread_once(&ownOnce, prepareOwn);
+        own = OutputOpen(STDOUT_FILENO);
+        PolyKeep(own);
+        own->lines = isatty(STDOUT_FILENO);
+        pthread_setspecific(ownKey, own);
+        pthread_mutex_lock(&ownsLock);
+        own->next = owns;
+        owns = own;
+        pthread_mutex_unlock(&ownsLock);
+        current = own;
+    }
+    return current;
+}
+
+/**
+ * The function writes out the output stream if it is written
+ * at the end of every line.
+ * @param[in,out] Stream : output stream
+ */
+static void endLine(outputStream *Stream) {
+    if (Stream->lines) {
+        writeAll(Stream->fd, Stream->buffer, Stream->used);
+        Stream->used = 0;
+    }
+}
+
+void OutputChar(char c) {
+    if (current != NULL) {
+        outputStream *Stream = target();
+        lockOwn(Stream);
+        streamPut(Stream, &c, 1);
+        if (c == '\n') {
+            endLine(Stream);
+        }
+        unlockOwn(Stream);
+        return;
+    }
+    if (used == OUTPUT_BUFFER) {
+        handOver();
+    }
+    buffers[active][used++] = c;
+    if (c == '\n' && lineFlush) {
+        OutputFlush();
+    }
+}
+
+void OutputString(const char *s) {
+    if (current != NULL) {
+        outputStream *Stream = target();
+        size_t length = strlen(s);
+        lockOwn(Stream);
+        streamPut(Stream, s, length);
+        if (length > 0 && s[length - 1] == '\n') {
+            endLine(Stream);
+        }
+        unlockOwn(Stream);
+        return;
+    }
+    while (*s != 0) {
+        OutputChar(*s);
+        ++s;
+    }
+}
+
+void OutputLong(long x) {
+    char digits[24];
+    size_t count = 0;
+    unsigned long u = x < 0 ? 0UL - (unsigned long) x : (unsigned long) x;
+
+    do {
+        digits[count++] = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (x < 0) {
+        digits[count++] = '-';
+    }
+
+    if (current != NULL) {
+        outputStream *Stream = target();
+        lockOwn(Stream);
+        while (count > 0) {
+            streamPut(Stream, &(digits[--count]), 1);
+        }
+        unlockOwn(Stream);
+        return;
+    }
+    if (OUTPUT_BUFFER - used < count) {
+        handOver();
+    }
+    while (count > 0) {
+        buffers[active][used++] = digits[--count];
+    }
+}
+
+void OutputError(size_t numberofLine, const char *message) {
+    if (errors == NULL) {
+        fprintf(stderr, "ERROR %ld %s\n", (long) numberofLine, message);
+    } else {
+        char prefix[32];
+        int length = snprintf(prefix, sizeof(prefix), "ERROR %ld ", (long) numberofLine);
+        streamPut(errors, prefix, (size_t) length);
+        streamPut(errors, message, strlen(message));
+        streamPut(errors, "\n", 1);
+    }
+}
+
+void OutputFlush(void) {
+    if (errors != NULL && errors != current) {
+        writeAll(errors->fd, errors->buffer, errors->used);
+        errors->used = 0;
+    }
+    if (current == &undecided) {
+        return;
+    }
+    if (current != NULL) {
+        lockOwn(current);
+        writeAll(current->fd, current->buffer, current->used);
+        current->used = 0;
+        unlockOwn(current);
+        return;
+    }
+    handOver();
+    if (threaded) {
+        while (sem_wait(&empty) != 0) {
+        }
+        sem_post(&empty);
+    }
+}
@@ -0,0 +1,99 @@
+/** @file
+  Interface of the buffered output of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The size of the output buffer.
+ */
+#define OUTPUT_BUFFER (1 << 20)
+
+/**
+ * The size of the buffer of an output stream.
+ */
+#define OUTPUT_STREAM_BUFFER (1 << 16)
+
+/**
+ * This is the buffered output written to a file descriptor.
+ */
+typedef struct outputStream outputStream;
+
+/**
+ * The function prepares the output of the calling thread, which gets
+ * the static buffers of the standard output. The buffer is written out when it is full,
+ * at the end of every line if the standard output is a terminal, and at exit.
+ * The other threads, and all of them if the function is never called, write
+ * the standard output through streams of their own, written out the same way
+ * and when the thread ends, so they may print at once.
+ * If @p async is set, the buffers are written out by a separate thread,
+ * so the computation goes on while the output drains.
+ * @param[in] async : should a writer thread be used?
+ */
+void OutputStart(bool async);
+
+/**
+ * The function creates a buffered output stream to the file descriptor.
+ * The memory is allocated by PolyMalloc, see polyAlloc.h.
+ * @param[in] fd : file descriptor
+ * @return output stream
+ */
+outputStream *OutputOpen(int fd);
+
+/**
+ * The function writes out the output stream and frees it.
+ * It does not close the file descriptor.
+ * @param[in] Stream : output stream
+ */
+void OutputClose(outputStream *Stream);
+
+/**
+ * The function sends the output and the error messages of the calling thread
+ * to the streams, which may be the same stream. The functions below write
+ * to the output of the calling thread, which is the standard output
+ * and the standard error until it is redirected.
+ * @param[in] Stream : output stream, NULL for the standard output
+ * @param[in] Errors : stream of the error messages, NULL for the standard error
+ */
+void OutputRedirect(outputStream *Stream, outputStream *Errors);
+
+/**
+ * The function appends a character to the output.
+ * @param[in] c : character
+ */
+void OutputChar(char c);
+
+/**
+ * The function appends a string to the output.
+ * @param[in] s : string
+ */
+void OutputString(const char *s);
+
+/**
+ * The function appends an integer written in decimal to the output.
+ * @param[in] x : integer
+ */
+void OutputLong(long x);
+
+/**
+ * The function reports an error of the given line. The message goes at once
+ * to the standard error or it is appended to the stream of the error messages.
+ * @param[in] numberofLine : number of line
+ * @param[in] message : message
+ */
+void OutputError(size_t numberofLine, const char *message);
+
+/**
+ * The function writes out everything that has been appended to the output
+ * and waits until it is written.
+ */
+void OutputFlush(void);
+
+#endif /* __OUTPUT_H__ */
@@ -0,0 +1,284 @@
+/** @file
+  Implementation of the pipelined execution of the calculator.
+  The stages are connected by a bounded ring of slots. Every slot goes
+  through the states FREE -> READ -> PARSED -> FREE: the reader fills it,
+  a parser parses it and the executor performs it and gives it back.
+  The slot of the line number n is n modulo PIPELINE_SLOTS, so every stage
+  only waits for the state of the next slot. The waiting threads sleep
+  on the condition variable of the slot, or of the pipeline while the line
+  is not read yet, so they take no processor time.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+#include "command.h"
+#include "mallocSafe.h"
+#include "output.h"
+#include "savePoly.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of lines which can be read ahead of the executed one.
+ */
+#define PIPELINE_SLOTS 1024
+
+/**
+ * The largest number of parser threads.
+ */
+#define MAX_STAGE_PARSERS 8
+
+/** The slot is empty and belongs to the reader. */
+#define SLOT_FREE 0
+/** The slot holds a line and belongs to a parser. */
+#define SLOT_READ 1
+/** The slot holds a parsed line and belongs to the executor. */
+#define SLOT_PARSED 2
+
+/**
+ * This is the slot holding one non-empty line of the input.
+ */
+typedef struct {
+    pthread_mutex_t lock;   ///< lock of the state and the index
+    pthread_cond_t changed; ///< signalled when the state changes
+    int state;              ///< state of the slot
+    size_t index;           ///< index of the line among the non-empty lines
+    size_t numberofLine;    ///< number of the line in the input
+    char *letters;          ///< copy of the line ending with 0
+    size_t numberofLetters; ///< number of characters
+    size_t capacity;        ///< size of the copy buffer
+    bool correct;           ///< is the polynomial correct?
+    Poly p;                 ///< parsed polynomial
+} slot;
+
+/**
+ * This is the state shared by the stages.
+ */
+typedef struct {
+    int fd;                  ///< file descriptor
+    slot *slots;             ///< ring of slots
+    atomic_size_t claimed;   ///< next line taken by a parser
+    pthread_mutex_t lock;    ///< lock of total and done
+    pthread_cond_t arrived;  ///< signalled when a line is read or the input ends
+    size_t total;            ///< number of lines read so far
+    bool done;               ///< has the reader reached the end of input?
+} pipeline;
+
+/**
+ * The function waits until the slot holds the given line in the given state.
+ * @param[in,out] Slot : slot
+ * @param[in] index : index of the line
+ * @param[in] state : state
+ */
+static void waitFor(slot *Slot, size_t index, int state) {
+    pthread_mutex_lock(&(Slot->lock));
+    while (Slot->state != state || Slot->index != index) {
+        pthread_cond_wait(&(Slot->changed), &(Slot->lock));
+    }
+    pthread_mutex_unlock(&(Slot->lock));
+}
+
+/**
+ * The function gives the slot to the next stage.
+ * @param[in,out] Slot : slot
+ * @param[in] index : index of the line
+ * @param[in] state : new state
+ */
+static void setState(slot *Slot, size_t index, int state) {
+    pthread_mutex_lock(&(Slot->lock));
+    Slot->index = index;
+    Slot->state = state;
+    pthread_cond_broadcast(&(Slot->changed));
+    pthread_mutex_unlock(&(Slot->lock));
+}
+
+/**
+ * The function notes the number of lines read and whether the input has ended.
+ * @param[in,out] Pipeline : pipeline
+ * @param[in] total : number of lines read
+ * @param[in] done : has the input ended?
+ */
+static void arrive(pipeline *Pipeline, size_t total, bool done) {
+    pthread_mutex_lock(&(Pipeline->lock));
+    Pipeline->total = total;
+    Pipeline->done = done;
+    pthread_cond_broadcast(&(Pipeline->arrived));
+    pthread_mutex_unlock(&(Pipeline->lock));
+}
+
+/**
+ * The function copies the line into the slot.
+ * @param[in,out] Slot : slot
+ * @param[in] Line : line
+ */
+static void copyLine(slot *Slot, const line *Line) {
+    if (Slot->capacity < Line->numberofLetters + 1) {
+        Slot->capacity = Line->numberofLetters + 1;
+        free(Slot->letters);
+        Slot->letters = (char *) mallocSafe(Slot->capacity);
+    }
+    memcpy(Slot->letters, Line->letters, Line->numberofLetters);
+    Slot->letters[Line->numberofLetters] = 0;
+    Slot->numberofLetters = Line->numberofLetters;
+}
+
+/**
+ * The main function of the reader thread. Empty lines and lines
+ * starting with '#' are skipped, but they are counted.
+ * @param[in,out] arg : pipeline
+ * @return NULL
+ */
+static void *reader(void *arg) {
+    pipeline *Pipeline = (pipeline *) arg;
+    lineReader *Reader = OpenReader(Pipeline->fd);
+    line Line;
+    size_t numberofLine = 0;
+    size_t index = 0;
+
+    while (NextLine(Reader, &Line)) {
+        ++numberofLine;
+        if (Line.numberofLetters == 0 || Line.letters[0] == '#') {
+            continue;
+        }
+
+        // The slot is given back by the executor after the line PIPELINE_SLOTS before.
+        slot *Slot = &(Pipeline->slots[index % PIPELINE_SLOTS]);
+        if (index >= PIPELINE_SLOTS) {
+            waitFor(Slot, index - PIPELINE_SLOTS, SLOT_FREE);
+        }
+        copyLine(Slot, &Line);
+        Slot->numberofLine = numberofLine;
+        setState(Slot, index, SLOT_READ);
+        ++index;
+        arrive(Pipeline, index, false);
+    }
+
+    CloseReader(Reader);
+    arrive(Pipeline, index, true);
+
+    return NULL;
+}
+
+/**
+ * The function checks if the line of the given index will ever be read.
+ * @param[in] Pipeline : pipeline
+ * @param[in] index : index of the line
+ * @return Will the line be read?
+ */
+static bool expected(pipeline *Pipeline, size_t index) {
+    pthread_mutex_lock(&(Pipeline->lock));
+    while (index >= Pipeline->total && !Pipeline->done) {
+        pthread_cond_wait(&(Pipeline->arrived), &(Pipeline->lock));
+    }
+    bool read = index < Pipeline->total;
+    pthread_mutex_unlock(&(Pipeline->lock));
+
+    return read;
+}
+
+/**
+ * The main function of a parser thread. Lines are taken in turns, so every
+ * parser works on a different line. Commands are passed on unchanged.
+ * @param[in,out] arg : pipeline
+ * @return NULL
+ */
+static void *parser(void *arg) {
+    pipeline *Pipeline = (pipeline *) arg;
+
+    while (true) {
+        size_t index = atomic_fetch_add(&(Pipeline->claimed), 1);
+        if (!expected(Pipeline, index)) {
+            return NULL;
+        }
+
+        slot *Slot = &(Pipeline->slots[index % PIPELINE_SLOTS]);
+        waitFor(Slot, index, SLOT_READ);
+        line Line = {.letters = Slot->letters, .numberofLetters = Slot->numberofLetters};
+        if (!IsCommand(&Line)) {
+            Slot->correct = ParsePoly(Slot->letters, Slot->numberofLetters, &(Slot->p));
+        }
+        setState(Slot, index, SLOT_PARSED);
+    }
+}
+
+/**
+ * The function performs the lines in their order.
+ * @param[in,out] Pipeline : pipeline
+ * @param[in,out] Stack : stack
+ */
+static void execute(pipeline *Pipeline, stack *Stack) {
+    for (size_t index = 0; expected(Pipeline, index); ++index) {
+        slot *Slot = &(Pipeline->slots[index % PIPELINE_SLOTS]);
+        waitFor(Slot, index, SLOT_PARSED);
+        line Line = {.letters = Slot->letters, .numberofLetters = Slot->numberofLetters};
+        if (IsCommand(&Line)) {
+            Command(&Line, Stack, Slot->numberofLine);
+        } else if (Slot->correct) {
+            Push(Stack, Slot->p);
+        } else {
+            OutputError(Slot->numberofLine, "WRONG POLY");
+        }
+        setState(Slot, index, SLOT_FREE);
+    }
+}
+
+bool RunPipeline(int fd, stack *Stack) {
+    pipeline Pipeline = {.fd = fd};
+    atomic_init(&(Pipeline.claimed), 0);
+    pthread_mutex_init(&(Pipeline.lock), NULL);
+    pthread_cond_init(&(Pipeline.arrived), NULL);
+    Pipeline.total = 0;
+    Pipeline.done = false;
+    Pipeline.slots = (slot *) mallocSafe(PIPELINE_SLOTS * sizeof(slot));
+    for (size_t i = 0; i < PIPELINE_SLOTS; ++i) {
+        pthread_mutex_init(&(Pipeline.slots[i].lock), NULL);
+        pthread_cond_init(&(Pipeline.slots[i].changed), NULL);
+        Pipeline.slots[i].state = SLOT_FREE;
+        Pipeline.slots[i].index = 0;
+        Pipeline.slots[i].letters = NULL;
+        Pipeline.slots[i].capacity = 0;
+    }
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t count = processors > 2 ? (size_t) processors - 2 : 1;
+    if (count > MAX_STAGE_PARSERS) {
+        count = MAX_STAGE_PARSERS;
+    }
+
+    pthread_t readerThread;
+    pthread_t parserThreads[MAX_STAGE_PARSERS];
+    size_t started = 0;
+    while (started < count &&
+           pthread_create(&(parserThreads[started]), NULL, parser, &Pipeline) == 0) {
+        ++started;
+    }
+    bool running = started > 0 &&
+                   pthread_create(&readerThread, NULL, reader, &Pipeline) == 0;
+
+    if (running) {
+        execute(&Pipeline, Stack);
+        pthread_join(readerThread, NULL);
+    } else {
+        arrive(&Pipeline, 0, true);
+    }
+
+    for (size_t t = 0; t < started; ++t) {
+        pthread_join(parserThreads[t], NULL);
+    }
+    for (size_t i = 0; i < PIPELINE_SLOTS; ++i) {
+        free(Pipeline.slots[i].letters);
+        pthread_mutex_destroy(&(Pipeline.slots[i].lock));
+        pthread_cond_destroy(&(Pipeline.slots[i].changed));
+    }
+    free(Pipeline.slots);
+    pthread_mutex_destroy(&(Pipeline.lock));
+    pthread_cond_destroy(&(Pipeline.arrived));
+
+    return running;
+}
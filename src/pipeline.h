@@ -0,0 +1,25 @@
+/** @file
+  Interface of the pipelined execution of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "stack.h"
+
+/**
+ * The function reads the lines from the file descriptor and performs them.
+ * One thread reads the lines, other threads parse the polynomials ahead
+ * of time and the calling thread performs the lines in their original order,
+ * so the output and the error messages are the same as without the pipeline.
+ * If the threads cannot be started, no line is read.
+ * @param[in] fd : file descriptor
+ * @param[in,out] Stack : stack
+ * @return Has the pipeline been run?
+ */
+bool RunPipeline(int fd, stack *Stack);
+
+#endif /* __PIPELINE_H__ */
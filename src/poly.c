@@ -7,39 +7,355 @@
 */
 
 #include "poly.h"
-#include "mallocSafe.h"
+#include "output.h"
+#include "polyMemo.h"
+#include "polySimd.h"
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+/**
+ * This is the memory block of one monomial, see PolyTermsBytes. A single term
+ * is copied into such a block on the C stack, so it can be read like any
+ * polynomial with monomials, see unpack.
+ */
+typedef struct {
+    poly_exp_t exp; ///< exponent
+    Poly factor;    ///< factor
+    Poly p;         ///< polynomial whose monomial is in this block
+} unpacked;
+
+_Static_assert(offsetof(unpacked, factor) ==
+               (sizeof(poly_exp_t) + _Alignof(Poly) - 1) / _Alignof(Poly) * _Alignof(Poly),
+               "the block of a single term has the layout of the memory block of one monomial");
+
+/** The probes of the kernels, see PolySetProbes. */
+static PolyProbes probes = {.enter = NULL, .leave = NULL};
+
+void PolySetProbes(const PolyProbes *Probes) {
+    if (Probes == NULL) {
+        probes = (PolyProbes) {.enter = NULL, .leave = NULL};
+    } else {
+        probes = *Probes;
+    }
+}
+
+/**
+ * The function gives the polynomial ready to be read through PolyFactors:
+ * the polynomial itself or, if it is a single term, its copy in @p u.
+ * The copy must not be changed nor freed and it lives as long as @p u.
+ * @param[in] p : non-constant polynomial
+ * @param[out] u : block of a single term
+ * @return polynomial with its monomials in a memory block
+ */
+static inline const Poly *unpack(const Poly *p, unpacked *u) {
+    if (!PolyIsTerm(p)) {
+        return p;
+    }
+
+    u->exp = PolyTermExp(p);
+    u->factor = PolyFromCoeff(p->coeff);
+    u->p = (Poly) {.size = 1, .exps = &(u->exp)};
+
+    return &(u->p);
+}
+
+/**
+ * The function checks whether the polynomial has a block of monomials,
+ * that is, whether it is neither a constant nor a single term.
+ * @param[in] p : polynomial
+ * @return whether @p p has a block of monomials
+ */
+static inline bool hasMonos(const Poly *p) {
+    return !PolyIsCoeff(p) && !PolyIsTerm(p);
+}
+
+/**
+ * The function replaces the polynomial made of one monomial with a constant
+ * factor by the single term, see PolyTerm, and frees its memory block.
+ * @param[in,out] r : polynomial
+ */
+static void makeTerm(Poly *r) {
+    if (!PolyIsCoeff(r) && !PolyIsTerm(r) && r->size == 1 && PolyIsCoeff(&(PolyFactors(r)[0]))) {
+        Poly t = PolyTerm(PolyFactors(r)[0].coeff, r->exps[0]);
+        PolyFree(r->exps);
+        *r = t;
+    }
+}
+
+/**
+ * The function allocates the memory block of the monomials of the polynomial,
+ * their exponents and factors are not set.
+ * @param[out] r : polynomial
+ * @param[in] size : number of monomials
+ */
+static void termsAlloc(Poly *r, size_t size) {
+    r->size = size;
+    r->exps = (poly_exp_t *) PolyMalloc(PolyTermsBytes(size));
+}
+
+/**
+ * The function keeps only the first monomials of the polynomial. The position
+ * of the factors depends on the number of monomials, so they are moved.
+ * @param[in,out] r : polynomial
+ * @param[in] size : new number of monomials
+ */
+static void termsShrink(Poly *r, size_t size) {
+    Poly *factors = PolyFactors(r);
+    r->size = size;
+    memmove(PolyFactors(r), factors, size * sizeof(Poly));
+}
+
+/**
+ * This is the number of exponents which packMonos keeps on the C stack.
+ */
+#define PACK_LOCAL 32
+
+/**
+ * The function turns the table of monomials into a polynomial in its own
+ * memory, without sorting or simplifying them: the factors are moved down
+ * behind the exponents, which take less space than the table had,
+ * and the rest of the block is given back to the allocator.
+ * A single monomial with a constant factor becomes a single term.
+ * @param[in] count : number of monomials
+ * @param[in] monos : table of monomials allocated by PolyMalloc
+ * @return polynomial
+ */
+static Poly packMonos(size_t count, Mono *monos) {
+    if (count == 1 && PolyIsCoeff(&(monos[0].p))) {
+        Poly r = PolyTerm(monos[0].p.coeff, MonoGetExp(&(monos[0])));
+        PolyFree(monos);
+        return r;
+    }
+
+    poly_exp_t local[PACK_LOCAL];
+    poly_exp_t *exps = count <= PACK_LOCAL ? local :
+                       (poly_exp_t *) PolyMalloc(count * sizeof(poly_exp_t));
+    Poly *factors = (Poly *) monos;
+
+    for (size_t i = 0; i < count; ++i) {
+        exps[i] = MonoGetExp(&(monos[i]));
+        Poly t = monos[i].p;
+        factors[i] = t;
+    }
+
+    Poly r = {.size = count, .exps = (poly_exp_t *) monos};
+    memmove(PolyFactors(&r), factors, count * sizeof(Poly));
+    memcpy(r.exps, exps, count * sizeof(poly_exp_t));
+
+    if (exps != local) {
+        PolyFree(exps);
+    }
+    r.exps = (poly_exp_t *) PolyRealloc(r.exps, PolyTermsBytes(count));
+
+    return r;
+}
+
+/**
+ * This is the element of the work stack of the non-recursive traversals.
+ * Every traversal uses only the fields it needs.
+ */
+typedef struct {
+    Poly value;     ///< polynomial taken over by value
+    Poly other;     ///< second polynomial taken over by value
+    const Poly *p;  ///< visited polynomial
+    const Poly *q;  ///< second visited polynomial
+    Poly *r;        ///< polynomial being built
+    size_t next;    ///< index of the next monomial to visit
+} frame;
+
+/**
+ * This is the work stack of the non-recursive traversals.
+ * It lives on the heap, so the depth of the polynomial
+ * does not affect the depth of the C stack.
+ */
+typedef struct {
+    frame *frames;    ///< array of frames
+    size_t size;      ///< number of frames on the stack
+    size_t capacity;  ///< array size
+} frameStack;
+
+/**
+ * The function creates an empty work stack.
+ * @return work stack
+ */
+static frameStack frameStackInit(void) {
+    return (frameStack) {.frames = NULL, .size = 0, .capacity = 0};
+}
+
+/**
+ * The function puts a frame on the work stack.
+ * @param[in,out] s : work stack
+ * @param[in] f : frame
+ */
+static void framePush(frameStack *s, frame f) {
+    if (s->size == s->capacity) {
+        s->capacity = 2 * s->capacity + 16;
+        s->frames = (frame *) PolyRealloc(s->frames, s->capacity * sizeof(frame));
+    }
+    s->frames[s->size] = f;
+    ++s->size;
+}
+
+/**
+ * The function pops a frame from the work stack.
+ * @param[in,out] s : work stack
+ * @return frame
+ */
+static frame framePop(frameStack *s) {
+    --s->size;
+    return s->frames[s->size];
+}
+
+/**
+ * The function frees the memory of the work stack.
+ * @param[in,out] s : work stack
+ */
+static void frameStackFree(frameStack *s) {
+    PolyFree(s->frames);
+}
 
 bool PolyIsZero(const Poly *p) {
     assert(p != NULL);
 
     if (PolyIsCoeff(p)) {
-        if (p->coeff == 0) {
-            return true;
+        return p->coeff == 0;
+    }
+
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.p = p});
+    bool zero = true;
+
+    while (zero && s.size > 0) {
+        const Poly *t = framePop(&s).p;
+        if (PolyIsCoeff(t) || PolyIsTerm(t)) {
+            zero = t->coeff == 0;
         } else {
-            return false;
-        }
-    } else {
-        for (size_t i = 0; i < p->size; ++i) {
-            if (!PolyIsZero(&(p->arr[i].p))) {
-                return false;
+            const Poly *factors = PolyFactors(t);
+            for (size_t i = 0; i < t->size; ++i) {
+                framePush(&s, (frame) {.p = &(factors[i])});
             }
         }
-        return true;
     }
+
+    frameStackFree(&s);
+    return zero;
 }
 
+_Static_assert(_Alignof(Poly) >= sizeof(Poly *),
+               "the exponents of every memory block of monomials have room for a pointer");
+
+/**
+ * The function frees the polynomial without allocating, so it can not fail
+ * half way. The freed blocks themselves make the work stack: the slot of
+ * the factor being visited keeps the size and the block of its polynomial,
+ * and the exponents of the factor, no longer needed, point to that slot.
+ * @param[in] p : polynomial
+ */
 void PolyDestroy(Poly *p) {
     assert(p != NULL);
 
-    if (!PolyIsCoeff(p)) {
-        for (size_t i = 0; i < p->size; ++i) {
-            PolyDestroy(&(p->arr[i].p));
+    if (!hasMonos(p)) {
+        return;
+    }
+
+    Poly t = *p;
+    Poly *up = NULL;
+    size_t i = 0;
+    memcpy(t.exps, &up, sizeof(up));
+
+    while (true) {
+        Poly *factors = PolyFactors(&t);
+        while (i < t.size && !hasMonos(&(factors[i]))) {
+            ++i;
+        }
+        if (i < t.size) {
+            Poly factor = factors[i];
+            factors[i] = t;
+            up = &(factors[i]);
+            memcpy(factor.exps, &up, sizeof(up));
+            t = factor;
+            i = 0;
+        } else {
+            memcpy(&up, t.exps, sizeof(up));
+            PolyFree(t.exps);
+            if (up == NULL) {
+                break;
+            }
+            t = *up;
+            i = (size_t) (up - PolyFactors(&t)) + 1;
         }
-        free(p->arr);
     }
 }
 
+size_t PolyCountMonos(const Poly *p, size_t limit) {
+    assert(p != NULL);
+
+    size_t count = 0;
+
+    if (PolyIsCoeff(p)) {
+        return count;
+    }
+
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.p = p});
+
+    while (count < limit && s.size > 0) {
+        const Poly *t = framePop(&s).p;
+        if (PolyIsTerm(t)) {
+            ++count;
+            continue;
+        }
+        const Poly *factors = PolyFactors(t);
+        count = count + t->size;
+        for (size_t i = 0; i < t->size; ++i) {
+            if (!PolyIsCoeff(&(factors[i]))) {
+                framePush(&s, (frame) {.p = &(factors[i])});
+            }
+        }
+    }
+
+    frameStackFree(&s);
+    return count < limit ? count : limit;
+}
+
+PolySizes PolyMeasure(const Poly *p) {
+    assert(p != NULL);
+
+    PolySizes sizes = {.terms = 0, .nodes = 0, .depth = 0, .bytes = 0};
+
+    if (PolyIsCoeff(p)) {
+        return sizes;
+    }
+
+    // The level of a polynomial is kept in the next field of its frame.
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.p = p, .next = 1});
+
+    while (s.size > 0) {
+        frame f = framePop(&s);
+        ++sizes.nodes;
+        if (f.next > sizes.depth) {
+            sizes.depth = f.next;
+        }
+        if (PolyIsTerm(f.p)) {
+            ++sizes.terms;
+            continue;
+        }
+        const Poly *factors = PolyFactors(f.p);
+        sizes.terms += f.p->size;
+        sizes.bytes += PolyTermsBytes(f.p->size);
+        for (size_t i = 0; i < f.p->size; ++i) {
+            if (!PolyIsCoeff(&(factors[i]))) {
+                framePush(&s, (frame) {.p = &(factors[i]), .next = f.next + 1});
+            }
+        }
+    }
+
+    frameStackFree(&s);
+    return sizes;
+}
+
 /**
  * In the PolyCloneHelp function, I add a neq parameter so that I can use it for authoring
  * opposite polynomials. Copying polynomials I give neq = 1, and creating opposite neq = -1.
@@ -50,18 +366,37 @@ void PolyDestroy(Poly *p) {
 static void PolyCloneHelp(const Poly *p, Poly *r, int neq) {
     assert(p != NULL && r != NULL);
 
-    if (PolyIsCoeff(p)) {
-        *r = PolyFromCoeff(neq * p->coeff);
-    } else {
-        r->size = p->size;
-        r->arr = mallocSafe(r->size * sizeof (Mono));
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.p = p, .r = r});
 
-        for (size_t i = 0; i < r->size; ++i) {
-            r->arr[i].exp = MonoGetExp(&(p->arr[i]));
+    while (s.size > 0) {
+        frame f = framePop(&s);
+        if (PolyIsCoeff(f.p)) {
+            *(f.r) = PolyFromCoeff(neq * f.p->coeff);
+            continue;
+        }
+        if (PolyIsTerm(f.p)) {
+            *(f.r) = PolyTerm(neq * f.p->coeff, PolyTermExp(f.p));
+            continue;
+        }
 
-            PolyCloneHelp(&(p->arr[i].p), &(r->arr[i].p), neq);
+        const Poly *factors = PolyFactors(f.p);
+        termsAlloc(f.r, f.p->size);
+        memcpy(f.r->exps, f.p->exps, f.p->size * sizeof(poly_exp_t));
+
+        Poly *copies = PolyFactors(f.r);
+        if (!PolySimdAllCoeffs(f.p->size, factors)) {
+            for (size_t i = 0; i < f.r->size; ++i) {
+                framePush(&s, (frame) {.p = &(factors[i]), .r = &(copies[i])});
+            }
+        } else if (neq == 1) {
+            memcpy(copies, factors, f.p->size * sizeof(Poly));
+        } else {
+            PolySimdNeg(f.p->size, factors, copies);
         }
     }
+
+    frameStackFree(&s);
 }
 
 Poly PolyClone(const Poly *p) {
@@ -94,209 +429,310 @@ static int compareMonos(const void * a, const void * b) {
 }
 
 /**
- * The PolyMonosClean function concatenates monomials with the same coefficients.
- * @param[in,out] r : polynomial
+ * The PolyMonosClean function sorts the table of monomials and concatenates
+ * monomials with the same exponents.
+ * @param[in,out] count : number of monomials
+ * @param[in,out] monos : table of monomials
  */
-static void PolyMonosClean(Poly *r) {
-    assert(!PolyIsCoeff(r));
+static void PolyMonosClean(size_t *count, Mono monos[]) {
+    assert(*count > 0);
 
-    qsort(r->arr, r->size, sizeof(Mono), compareMonos);
+    if (probes.enter != NULL) {
+        probes.enter(POLY_KERNEL_CLEAN);
+    }
+
+    qsort(monos, *count, sizeof(Mono), compareMonos);
 
-    for (size_t i = 0; i < r->size - 1; ++i) {
-        if (MonoGetExp(&(r->arr[i])) == MonoGetExp(&(r->arr[i + 1]))) {
-            poly_exp_t n = MonoGetExp(&(r->arr[i]));
-            --r->size;
+    for (size_t i = 0; i < *count - 1; ++i) {
+        if (MonoGetExp(&(monos[i])) == MonoGetExp(&(monos[i + 1]))) {
+            poly_exp_t n = MonoGetExp(&(monos[i]));
+            --*count;
 
-            Poly t = PolyAdd(&(r->arr[i].p), &(r->arr[i + 1].p));
+            Poly t = PolyAdd(&(monos[i].p), &(monos[i + 1].p));
 
-            PolyDestroy(&(r->arr[i].p));
-            PolyDestroy(&(r->arr[i + 1].p));
+            PolyDestroy(&(monos[i].p));
+            PolyDestroy(&(monos[i + 1].p));
 
-            r->arr[i].exp = n;
-            r->arr[i].p = t;
+            monos[i].exp = n;
+            monos[i].p = t;
 
-            for (size_t j = i + 1; j < r->size; ++j) {
-                r->arr[j] = r->arr[j + 1];
+            for (size_t j = i + 1; j < *count; ++j) {
+                monos[j] = monos[j + 1];
             }
             --i;
         }
     }
-}
 
-/**
- * The reductionToCoeff function simplifies the polynomials possible to constant polynomials,
- * e.g. 2 * x_0^0 * x_1^0 simplifies to 2.
- * @param[in,out] r : polynomial
- * @param[out] i : coefficient
- */
-static void reductionToCoeff(Poly *r, poly_coeff_t *i) {
-    if (!PolyIsCoeff(r)) {
-        if (r->size == 1 && r->arr[0].exp == 0) {
-            if (PolyIsCoeff(&(r->arr[0].p))) {
-                *i = r->arr[0].p.coeff;
-            } else {
-                reductionToCoeff(&(r->arr[0].p), i);
-            }
-        }
+    if (probes.leave != NULL) {
+        probes.leave(POLY_KERNEL_CLEAN);
     }
 }
 
 /**
- * The reduction function looks for polynomials that can be simplified and simplifies them.
- * @param[in,out] r : polynomial
+ * The function brings a single term to the normal form: a term with the
+ * exponent 0 or the coefficient 0 is a constant.
+ * @param[in,out] r : single term
  */
-static void reduction(Poly *r) {
-    if (!PolyIsCoeff(r)) {
-        for (size_t i = 0; i < r->size; ++i) {
-            reduction(&(r->arr[i].p));
-        }
-        poly_coeff_t i = 0;
-        reductionToCoeff(r, &i);
-        if (i != 0) {
-            PolyDestroy(r);
-            *r = PolyFromCoeff(i);
-        }
+static void cleanTerm(Poly *r) {
+    if (PolyTermExp(r) == 0 || r->coeff == 0) {
+        *r = PolyFromCoeff(r->coeff);
     }
 }
 
 /**
- * PolyCleanZero function removes zeros from non-constant polynomial.
+ * The function brings a polynomial with monomials, whose factors are in
+ * the normal form, to the normal form too: it removes the zero factors,
+ * replaces a polynomial equal to a constant by the constant and a monomial
+ * with a constant factor left alone by the single term.
  * @param[in,out] r : polynomial
  */
-static void PolyCleanZero(Poly *r) {
-    assert(r != NULL);
-
-    if (!PolyIsCoeff(r)) {
-        for (size_t i = 0; i < r->size; ++i) {
-            if (PolyIsZero(&(r->arr[i].p))) {
-                MonoDestroy(&(r->arr[i]));
-                --r->size;
+static void cleanMonos(Poly *r) {
+    Poly *factors = PolyFactors(r);
+    size_t k = 0;
+    for (size_t i = 0; i < r->size; ++i) {
+        if (!PolyIsCoeff(&(factors[i])) || factors[i].coeff != 0) {
+            r->exps[k] = r->exps[i];
+            factors[k] = factors[i];
+            ++k;
+        }
+    }
 
-                for (size_t j = i; j < r->size; ++j) {
-                    r->arr[j] = r->arr[j + 1];
-                }
-            } else {
-                PolyCleanZero(&(r->arr[i].p));
-            }
+    if (k == 0) {
+        PolyFree(r->exps);
+        *r = PolyZero();
+    } else if (k == 1 && r->exps[0] == 0 && PolyIsCoeff(&(factors[0]))) {
+        poly_coeff_t c = factors[0].coeff;
+        PolyFree(r->exps);
+        *r = PolyFromCoeff(c);
+    } else {
+        if (k < r->size) {
+            termsShrink(r, k);
         }
+        makeTerm(r);
     }
 }
 
 /**
- * The PolyClean function looks for polynomials equal to constant polynomials
- * and simplifies them to constant polynomials if they were not, and removes the zeros.
+ * The PolyClean function brings the polynomial to the normal form, see
+ * cleanTerm and cleanMonos. The polynomial is visited in post-order on the
+ * work stack, so the factors are in the normal form before their polynomial.
  * @param[in,out] r : polynomial
  */
 static void PolyClean(Poly *r) {
-    if (PolyIsZero(r)) {
-        PolyDestroy(r);
-        *r = PolyZero();
-    } else {
-        PolyCleanZero(r);
+    if (PolyIsTerm(r)) {
+        cleanTerm(r);
+    }
+    if (!hasMonos(r)) {
+        return;
+    }
+
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.r = r, .next = 0});
+
+    while (s.size > 0) {
+        frame *f = &(s.frames[s.size - 1]);
+        if (f->next < f->r->size) {
+            Poly *t = &(PolyFactors(f->r)[f->next]);
+            ++f->next;
+            if (PolyIsTerm(t)) {
+                cleanTerm(t);
+            } else if (!PolyIsCoeff(t)) {
+                framePush(&s, (frame) {.r = t, .next = 0});
+            }
+        } else {
+            cleanMonos(framePop(&s).r);
+        }
     }
 
-    reduction(r);
+    frameStackFree(&s);
 }
 
 /**
- * The PolyAddHelp function checks which polynomials are constants and
+ * The addLevel function checks which polynomials are constants and
  * passes them to the appropriate adding functions.
  * @param[in] p : polynomial
  * @param[in] q : polynomial
  * @param[out] r : polynomial
+ * @param[in,out] s : work stack of the sums of the factors left to add
  */
-static void PolyAddHelp(const Poly *p, const Poly *q, Poly *r);
+static void addLevel(const Poly *p, const Poly *q, Poly *r, frameStack *s);
 
 /**
- * The oneCoeffAdd function adds a constant to the polynomial.
+ * The oneCoeffAdd function adds a constant to the polynomial. The sum with
+ * the factor at the exponent 0 is left on the work stack.
  * @param[in] p : polynomial
  * @param[out] r : polynomial
  * @param[in] c : coefficient
+ * @param[in,out] s : work stack of the sums of the factors left to add
  */
-static void oneCoeffAdd(const Poly *p, Poly *r, poly_coeff_t c) {
-    assert(p != NULL && p->arr != NULL);
+static void oneCoeffAdd(const Poly *p, Poly *r, poly_coeff_t c, frameStack *s) {
+    assert(p != NULL && p->exps != NULL);
+
+    if (PolyIsTerm(p) && PolyTermExp(p) == 0) {
+        *r = PolyFromCoeff(p->coeff + c);
+        return;
+    }
+
+    unpacked u;
+    p = unpack(p, &u);
+    const Poly *factors = PolyFactors(p);
 
-    if (PolyIsCoeff(&(p->arr[0].p)) && MonoGetExp(&(p->arr[0])) == 0) {
+    if (PolyIsCoeff(&(factors[0])) && p->exps[0] == 0) {
         *r = PolyClone(p);
-        r->arr[0].p.coeff =  r->arr[0].p.coeff + c;
+        PolyFactors(r)[0].coeff = PolyFactors(r)[0].coeff + c;
     } else {
-        if (MonoGetExp(&(p->arr[0])) == 0) {
-            r->size = p->size;
-            r->arr = (Mono*) mallocSafe(r->size * sizeof (Mono));
+        if (p->exps[0] == 0) {
+            termsAlloc(r, p->size);
+            memcpy(r->exps, p->exps, p->size * sizeof(poly_exp_t));
+            Poly *sums = PolyFactors(r);
             for (size_t i = 1; i < r->size; ++i) {
-                r->arr[i] = MonoClone(&(p->arr[i]));
+                sums[i] = PolyClone(&(factors[i]));
             }
-            r->arr[0].exp = 0;
-            oneCoeffAdd(&(p->arr[0].p), &(r->arr[0].p), c);
+            framePush(s, (frame) {.value = factors[0], .other = PolyFromCoeff(c), .r = &(sums[0])});
         } else {
-            r->size = p->size + 1;
-            r->arr = (Mono *) mallocSafe(r->size * sizeof(Mono));
-            r->arr[0].p = PolyFromCoeff(c);
-            r->arr[0].exp = 0;
+            termsAlloc(r, p->size + 1);
+            memcpy(r->exps + 1, p->exps, p->size * sizeof(poly_exp_t));
+            Poly *sums = PolyFactors(r);
+            r->exps[0] = 0;
+            sums[0] = PolyFromCoeff(c);
             for (size_t i = 0; i < p->size; ++i) {
-                r->arr[i + 1] = MonoClone(&(p->arr[i]));
+                sums[i + 1] = PolyClone(&(factors[i]));
             }
         }
     }
 }
 
+/**
+ * The function counts the different exponents of two polynomials.
+ * @param[in] p : polynomial with monomials
+ * @param[in] q : polynomial with monomials
+ * @return number of the monomials of the sum before cleaning
+ */
+static size_t countExps(const Poly *p, const Poly *q) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t k = 0;
+
+    while (i < p->size && j < q->size) {
+        if (p->exps[i] <= q->exps[j]) {
+            j = j + (p->exps[i] == q->exps[j]);
+            ++i;
+        } else {
+            ++j;
+        }
+        ++k;
+    }
+
+    return k + (p->size - i) + (q->size - j);
+}
+
 /**
  * The noCoeffAdd function adds two non-constant polynomials together.
+ * The sums of the factors with equal exponents are left on the work stack,
+ * so the memory block of the result is allocated with its final size.
  * @param[in] p : polynomial
  * @param[in] q : polynomial
  * @param[out] r : polynomial
+ * @param[in,out] s : work stack of the sums of the factors left to add
  */
-static void noCoeffAdd(const Poly *p, const Poly *q, Poly *r) {
+static void noCoeffAdd(const Poly *p, const Poly *q, Poly *r, frameStack *s) {
     assert(p != NULL && q != NULL);
 
-    r->arr = (Mono*) mallocSafe((p->size + q->size) * sizeof (Mono));
+    if (PolyIsTerm(p) && PolyIsTerm(q) && PolyTermExp(p) == PolyTermExp(q)) {
+        *r = PolyTerm(p->coeff + q->coeff, PolyTermExp(p));
+        return;
+    }
 
+    unpacked u;
+    unpacked v;
+    p = unpack(p, &u);
+    q = unpack(q, &v);
+    const poly_exp_t *pExps = p->exps;
+    const poly_exp_t *qExps = q->exps;
+    const Poly *pFactors = PolyFactors(p);
+    const Poly *qFactors = PolyFactors(q);
+
+    if (p->size == q->size && memcmp(pExps, qExps, p->size * sizeof(poly_exp_t)) == 0 &&
+        PolySimdAllCoeffs(p->size, pFactors) && PolySimdAllCoeffs(q->size, qFactors)) {
+        // The innermost levels with the same exponents are added at once.
+        termsAlloc(r, p->size);
+        memcpy(r->exps, pExps, p->size * sizeof(poly_exp_t));
+        PolySimdAdd(p->size, pFactors, qFactors, PolyFactors(r));
+        return;
+    }
+
+    termsAlloc(r, countExps(p, q));
+
+    Poly *sums = PolyFactors(r);
     size_t i = 0;
     size_t j = 0;
     size_t k = 0;
 
     while (i < p->size || j < q->size) {
         if (i == p->size) {
-            r->arr[k] = q->arr[j];
+            r->exps[k] = qExps[j];
+            sums[k] = PolyClone(&(qFactors[j]));
             ++j;
         } else if (j == q->size) {
-            r->arr[k] = p->arr[i];
+            r->exps[k] = pExps[i];
+            sums[k] = PolyClone(&(pFactors[i]));
             ++i;
         } else {
-            if (MonoGetExp(&(p->arr[i])) < MonoGetExp(&(q->arr[j]))) {
-                r->arr[k] = MonoClone(&(p->arr[i]));
+            if (pExps[i] < qExps[j]) {
+                r->exps[k] = pExps[i];
+                sums[k] = PolyClone(&(pFactors[i]));
                 ++i;
-            } else if (MonoGetExp(&(p->arr[i])) == MonoGetExp(&(q->arr[j]))) {
-                r->arr[k].exp = MonoGetExp(&(p->arr[i]));
-                PolyAddHelp(&(p->arr[i].p), &(q->arr[j].p), &(r->arr[k].p));
+            } else if (pExps[i] == qExps[j]) {
+                r->exps[k] = pExps[i];
+                framePush(s, (frame) {.value = pFactors[i], .other = qFactors[j], .r = &(sums[k])});
                 ++i;
                 ++j;
             } else {
-                r->arr[k] = MonoClone(&(q->arr[j]));
+                r->exps[k] = qExps[j];
+                sums[k] = PolyClone(&(qFactors[j]));
                 ++j;
             }
         }
         ++k;
     }
-    r->size = k;
 }
 
-static void PolyAddHelp(const Poly *p, const Poly *q, Poly *r) {
+static void addLevel(const Poly *p, const Poly *q, Poly *r, frameStack *s) {
     assert(p != NULL && q != NULL);
 
     if (PolyIsCoeff(p)) {
         if (PolyIsCoeff(q)) {
             *r = PolyFromCoeff(p->coeff + q->coeff);
         } else {
-            oneCoeffAdd(q, r, p->coeff);
+            oneCoeffAdd(q, r, p->coeff, s);
         }
     } else if (PolyIsCoeff(q)) {
-        oneCoeffAdd(p, r, q->coeff);
+        oneCoeffAdd(p, r, q->coeff, s);
     } else {
-        noCoeffAdd(p, q, r);
+        noCoeffAdd(p, q, r, s);
     }
 }
 
+/**
+ * The PolyAddHelp function adds two polynomials level by level, so the depth
+ * of the polynomials does not affect the depth of the C stack. The factors
+ * are taken over by value, as the single terms are unpacked on the C stack.
+ * @param[in] p : polynomial
+ * @param[in] q : polynomial
+ * @param[out] r : polynomial
+ */
+static void PolyAddHelp(const Poly *p, const Poly *q, Poly *r) {
+    frameStack s = frameStackInit();
+
+    addLevel(p, q, r, &s);
+    while (s.size > 0) {
+        frame f = framePop(&s);
+        addLevel(&(f.value), &(f.other), f.r, &s);
+    }
+
+    frameStackFree(&s);
+}
+
 Poly PolyAdd(const Poly *p, const Poly *q) {
     Poly r;
 
@@ -309,15 +745,15 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
 Poly PolyAddMonos(size_t count, const Mono monos[]) {
     assert(count > 0 || monos != NULL);
 
-    Poly r;
-    r.arr = (Mono*) mallocSafe(count * sizeof (Mono));
-    r.size = count;
-
-    for (size_t i = 0; i < count; ++i) {
-        r.arr[i] = monos[i];
+    if (count == 0) {
+        return PolyZero();
     }
 
-    PolyMonosClean(&r);
+    Mono *copy = (Mono *) PolyMalloc(count * sizeof(Mono));
+    memcpy(copy, monos, count * sizeof(Mono));
+
+    PolyMonosClean(&count, copy);
+    Poly r = packMonos(count, copy);
     PolyClean(&r);
 
     return r;
@@ -335,16 +771,23 @@ static void PolyMulHelp(const Poly *p, const Poly *q, Poly *r);
 static void oneCoeffMul(const Poly *p, poly_coeff_t q, Poly *r) {
     assert(p != NULL);
 
-    if (!PolyIsCoeff(p)) {
-        r->arr = (Mono*) mallocSafe(p->size * sizeof (Mono));
-        r->size = p->size;
+    if (PolyIsCoeff(p)) {
+        *r = PolyFromCoeff(p->coeff * q);
+    } else if (PolyIsTerm(p)) {
+        *r = PolyTerm(p->coeff * q, PolyTermExp(p));
+    } else {
+        termsAlloc(r, p->size);
+        memcpy(r->exps, p->exps, p->size * sizeof(poly_exp_t));
 
-        for (size_t i = 0; i < p->size; ++i) {
-            r->arr[i].exp = MonoGetExp(&(p->arr[i]));
-            oneCoeffMul(&(p->arr[i].p), q, &(r->arr[i].p));
+        const Poly *factors = PolyFactors(p);
+        Poly *products = PolyFactors(r);
+        if (PolySimdAllCoeffs(p->size, factors)) {
+            PolySimdScale(p->size, factors, q, products);
+        } else {
+            for (size_t i = 0; i < p->size; ++i) {
+                oneCoeffMul(&(factors[i]), q, &(products[i]));
+            }
         }
-    } else {
-        *r = PolyFromCoeff(p->coeff * q);
     }
 }
 
@@ -357,17 +800,32 @@ static void oneCoeffMul(const Poly *p, poly_coeff_t q, Poly *r) {
 static void noCoeffMul(const Poly *p, const Poly *q, Poly *r) {
     assert(p != NULL && q != NULL);
 
-    r->size = p->size * q->size;
-    r->arr = (Mono *) mallocSafe(r->size * sizeof(Mono));
+    if (probes.enter != NULL) {
+        probes.enter(POLY_KERNEL_MUL);
+    }
+
+    unpacked u;
+    unpacked v;
+    p = unpack(p, &u);
+    q = unpack(q, &v);
+    size_t count = p->size * q->size;
+    Mono *monos = (Mono *) PolyMalloc(count * sizeof(Mono));
+    const Poly *pFactors = PolyFactors(p);
+    const Poly *qFactors = PolyFactors(q);
 
     for (size_t i = 0; i < p->size; ++i) {
         for (size_t j = 0; j < q->size; ++j) {
-            r->arr[i * q->size + j].exp = MonoGetExp(&(p->arr[i])) + MonoGetExp(&(q->arr[j]));
-            PolyMulHelp(&(p->arr[i].p), &(q->arr[j].p), &(r->arr[i * q->size + j].p));
+            monos[i * q->size + j].exp = p->exps[i] + q->exps[j];
+            PolyMulHelp(&(pFactors[i]), &(qFactors[j]), &(monos[i * q->size + j].p));
         }
     }
 
-    PolyMonosClean(r);
+    PolyMonosClean(&count, monos);
+    *r = packMonos(count, monos);
+
+    if (probes.leave != NULL) {
+        probes.leave(POLY_KERNEL_MUL);
+    }
 }
 
 /**
@@ -389,6 +847,8 @@ static void PolyMulHelp(const Poly *p, const Poly *q, Poly *r) {
     } else {
         if (PolyIsCoeff(q)) {
             oneCoeffMul(p, q->coeff, r);
+        } else if (PolyIsTerm(p) && PolyIsTerm(q)) {
+            *r = PolyTerm(p->coeff * q->coeff, PolyTermExp(p) + PolyTermExp(q));
         } else {
             noCoeffMul(p, q, r);
         }
@@ -407,6 +867,283 @@ Poly PolyMul(const Poly *p, const Poly *q) {
     return r;
 }
 
+/**
+ * This is the lowest total degree of the factor of a monomial, see lowDegs.
+ */
+typedef struct lowDeg {
+    const Poly *factor;          ///< factor of the monomial
+    long long low;               ///< the lowest total degree of the factor
+    const struct lowDeg *inner;  ///< degrees of the monomials of the factor
+} lowDeg;
+
+/**
+ * This is the degree of the factor of a single term, which is a constant.
+ */
+static const lowDeg termLow = {.factor = NULL, .low = 0, .inner = NULL};
+
+/**
+ * The lowDegOf function returns the smallest total degree of a monomial
+ * of the polynomial (0 for a constant polynomial).
+ * @param[in] p : polynomial
+ * @param[in] low : degrees of the monomials of @p p, see lowDegs
+ * @return the lowest total degree
+ */
+static long long lowDegOf(const Poly *p, const lowDeg *low) {
+    if (PolyIsCoeff(p)) {
+        return 0;
+    }
+    if (PolyIsTerm(p)) {
+        return PolyTermExp(p);
+    }
+
+    long long result = -1;
+    for (size_t i = 0; i < p->size; ++i) {
+        long long t = p->exps[i] + low[i].low;
+        if (result == -1 || t < result) {
+            result = t;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * The lowDegs function computes in one pass the lowest total degree of the
+ * factor of every monomial in the tree of the polynomial. The degrees are
+ * laid out breadth first, so the degrees of the monomials of a factor come
+ * after the factor itself and are known when the array is filled backwards.
+ * @param[in] p : polynomial which has a block of monomials
+ * @return array of degrees of the monomials of @p p, allocated by PolyMalloc
+ */
+static lowDeg *lowDegs(const Poly *p) {
+    assert(hasMonos(p));
+
+    lowDeg *low = (lowDeg *) PolyMalloc(PolyCountMonos(p, SIZE_MAX) * sizeof(lowDeg));
+    size_t count = p->size;
+
+    for (size_t i = 0; i < p->size; ++i) {
+        low[i].factor = &(PolyFactors(p)[i]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const Poly *f = low[i].factor;
+        low[i].inner = NULL;
+        if (hasMonos(f)) {
+            low[i].inner = &(low[count]);
+            for (size_t j = 0; j < f->size; ++j) {
+                low[count + j].factor = &(PolyFactors(f)[j]);
+            }
+            count = count + f->size;
+        }
+    }
+    for (size_t i = count; i-- > 0;) {
+        low[i].low = lowDegOf(low[i].factor, low[i].inner);
+    }
+
+    return low;
+}
+
+/**
+ * The PolyLowDeg function returns the smallest total degree of a monomial
+ * of the polynomial (0 for a constant polynomial).
+ * @param[in] p : polynomial
+ * @return the lowest total degree
+ */
+static long long PolyLowDeg(const Poly *p) {
+    if (!hasMonos(p)) {
+        return lowDegOf(p, NULL);
+    }
+
+    lowDeg *low = lowDegs(p);
+    long long result = lowDegOf(p, low);
+    PolyFree(low);
+
+    return result;
+}
+
+/**
+ * The oneCoeffMulTrunc function multiplies the polynomial by a scalar and
+ * skips all the monomials of total degree greater than @p deg.
+ * Monomials are sorted by the exponent, so the loop stops at the first
+ * exponent exceeding the bound.
+ * @param[in] p : polynomial
+ * @param[in] c : coefficient
+ * @param[in] deg : degree bound
+ * @param[out] r : polynomial
+ */
+static void oneCoeffMulTrunc(const Poly *p, poly_coeff_t c, long long deg, Poly *r) {
+    assert(p != NULL);
+
+    if (PolyIsCoeff(p)) {
+        *r = PolyFromCoeff(p->coeff * c);
+    } else if (PolyIsTerm(p)) {
+        *r = PolyTermExp(p) <= deg ? PolyTerm(p->coeff * c, PolyTermExp(p)) : PolyZero();
+    } else {
+        termsAlloc(r, p->size);
+
+        const Poly *factors = PolyFactors(p);
+        Poly *products = PolyFactors(r);
+        size_t k = 0;
+        for (size_t i = 0; i < p->size && p->exps[i] <= deg; ++i) {
+            r->exps[k] = p->exps[i];
+            oneCoeffMulTrunc(&(factors[i]), c, deg - p->exps[i], &(products[k]));
+            ++k;
+        }
+
+        if (k == 0) {
+            PolyFree(r->exps);
+            *r = PolyZero();
+        } else {
+            termsShrink(r, k);
+        }
+    }
+}
+
+static void PolyMulTruncHelp(const Poly *p, const lowDeg *lowP,
+                             const Poly *q, const lowDeg *lowQ, long long deg, Poly *r);
+
+/**
+ * The noCoeffMulTrunc function multiplies two non-constant polynomials
+ * and never generates a monomial of total degree greater than @p deg.
+ * Pairs of monomials are pruned with the lowest degrees of their
+ * coefficients. The first pass only counts the surviving pairs, so the array
+ * of monomials is never larger than the truncated product.
+ * @param[in] p : polynomial
+ * @param[in] lowP : degrees of the monomials of @p p, see lowDegs
+ * @param[in] q : polynomial
+ * @param[in] lowQ : degrees of the monomials of @p q, see lowDegs
+ * @param[in] deg : degree bound
+ * @param[out] r : polynomial
+ */
+static void noCoeffMulTrunc(const Poly *p, const lowDeg *lowP,
+                            const Poly *q, const lowDeg *lowQ, long long deg, Poly *r) {
+    assert(p != NULL && q != NULL);
+
+    if (PolyIsTerm(p)) {
+        lowP = &termLow;
+    }
+    if (PolyIsTerm(q)) {
+        lowQ = &termLow;
+    }
+    unpacked u;
+    unpacked v;
+    p = unpack(p, &u);
+    q = unpack(q, &v);
+    const Poly *pFactors = PolyFactors(p);
+    const Poly *qFactors = PolyFactors(q);
+    Mono *monos = NULL;
+
+    size_t count = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t k = 0;
+        for (size_t i = 0; i < p->size && p->exps[i] <= deg; ++i) {
+            if (p->exps[i] + lowP[i].low > deg) {
+                continue;
+            }
+            for (size_t j = 0; j < q->size; ++j) {
+                long long exp = (long long) p->exps[i] + q->exps[j];
+                if (exp > deg) {
+                    break;
+                }
+                if (exp + lowP[i].low + lowQ[j].low <= deg) {
+                    if (pass == 1) {
+                        monos[k].exp = (poly_exp_t) exp;
+                        PolyMulTruncHelp(&(pFactors[i]), lowP[i].inner,
+                                         &(qFactors[j]), lowQ[j].inner, deg - exp, &(monos[k].p));
+                    }
+                    ++k;
+                }
+            }
+        }
+        if (pass == 0) {
+            count = k;
+            if (count == 0) {
+                break;
+            }
+            monos = (Mono *) PolyMalloc(count * sizeof(Mono));
+        }
+    }
+
+    if (count == 0) {
+        *r = PolyZero();
+    } else {
+        PolyMonosClean(&count, monos);
+        *r = packMonos(count, monos);
+    }
+}
+
+/**
+ * The PolyMulTruncHelp function checks which polynomials are constants and
+ * passes them to the appropriate truncated multiplication functions.
+ * @param[in] p : polynomial
+ * @param[in] lowP : degrees of the monomials of @p p, see lowDegs
+ * @param[in] q : polynomial
+ * @param[in] lowQ : degrees of the monomials of @p q, see lowDegs
+ * @param[in] deg : degree bound
+ * @param[out] r : polynomial
+ */
+static void PolyMulTruncHelp(const Poly *p, const lowDeg *lowP,
+                             const Poly *q, const lowDeg *lowQ, long long deg, Poly *r) {
+    assert(p != NULL && q != NULL);
+
+    if (PolyIsCoeff(p)) {
+        oneCoeffMulTrunc(q, p->coeff, deg, r);
+    } else if (PolyIsCoeff(q)) {
+        oneCoeffMulTrunc(p, q->coeff, deg, r);
+    } else {
+        noCoeffMulTrunc(p, lowP, q, lowQ, deg, r);
+    }
+}
+
+Poly PolyMulTrunc(const Poly *p, const Poly *q, poly_exp_t deg) {
+    assert(p != NULL && q != NULL && deg >= 0);
+
+    Poly r;
+    lowDeg *lowP = hasMonos(p) && !PolyIsCoeff(q) ? lowDegs(p) : NULL;
+    lowDeg *lowQ = hasMonos(q) && !PolyIsCoeff(p) ? lowDegs(q) : NULL;
+
+    PolyMulTruncHelp(p, lowP, q, lowQ, deg, &r);
+
+    PolyFree(lowP);
+    PolyFree(lowQ);
+
+    PolyClean(&r);
+
+    return r;
+}
+
+Poly PolyExpTrunc(const Poly *p, poly_exp_t exp, poly_exp_t deg) {
+    assert(p != NULL && exp >= 0 && deg >= 0);
+
+    long long low = PolyLowDeg(p);
+    if (exp > 0 && low > deg / exp) {
+        return PolyZero();
+    }
+
+    Poly result = PolyFromCoeff(1);
+    Poly base;
+
+    oneCoeffMulTrunc(p, 1, deg, &base);
+    PolyClean(&base);
+
+    while (exp > 0) {
+        if (exp % 2 == 1) {
+            Poly t = PolyMulTrunc(&result, &base, deg);
+            PolyDestroy(&result);
+            result = t;
+        }
+        exp = exp / 2;
+        if (exp > 0) {
+            Poly t = PolyMulTrunc(&base, &base, deg);
+            PolyDestroy(&base);
+            base = t;
+        }
+    }
+
+    PolyDestroy(&base);
+
+    return result;
+}
+
 Poly PolyNeg(const Poly *p) {
     assert (p != NULL);
 
@@ -440,12 +1177,15 @@ static void PolyDegByHelp(const Poly *p, poly_exp_t *exp_max, size_t *index, siz
     ++*index;
 
     if (!PolyIsCoeff(p) && *index <= var_idx) {
+        unpacked u;
+        p = unpack(p, &u);
+        const Poly *factors = PolyFactors(p);
         for (size_t i = 0; i < p->size; ++i) {
-            if (*index == var_idx && MonoGetExp(&(p->arr[i])) > *exp_max) {
-                *exp_max = MonoGetExp(&(p->arr[i]));
+            if (*index == var_idx && p->exps[i] > *exp_max) {
+                *exp_max = p->exps[i];
             }
 
-            PolyDegByHelp(&(p->arr[i].p), exp_max, index, var_idx);
+            PolyDegByHelp(&(factors[i]), exp_max, index, var_idx);
         }
     } else {
         --*index;
@@ -471,10 +1211,14 @@ poly_exp_t PolyDeg(const Poly *p) {
     assert(p != NULL);
 
     if (!PolyIsCoeff(p)) {
+        unpacked u;
+        p = unpack(p, &u);
+        const Poly *factors = PolyFactors(p);
         poly_exp_t exp_max = -1;
         for (size_t i = 0; i < p->size; ++i) {
-            if (PolyDeg(&(p->arr[i].p)) + p->arr[i].exp > exp_max) {
-                exp_max = PolyDeg(&(p->arr[i].p)) + p->arr[i].exp;
+            poly_exp_t deg = PolyDeg(&(factors[i])) + p->exps[i];
+            if (deg > exp_max) {
+                exp_max = deg;
             }
         }
 
@@ -489,50 +1233,56 @@ poly_exp_t PolyDeg(const Poly *p) {
 }
 
 /**
-* The PolyIsEqHelp function is a helper to PolyIsEq, has
- * additional bool type parameter initially set to true, which changes to
- * false when seeing any difference in the polynomials. This feature would consider
- * polynon 0 * x and 2x ^ 2 and 2x ^ 2 for different. However, the rest of the creating functions
- * polynomials do not allow such polynomials to arise.
+ * The PolyIsEqHelp function is a helper to PolyIsEq. It compares the polynomials
+ * level by level and stops at the first difference. This function would consider
+ * polynomials 0 * x and 2x ^ 2 and 2x ^ 2 different. However, the rest of the
+ * functions creating polynomials do not allow such polynomials to arise.
  * @param[in] p : polynomial
  * @param[in] q : polynomial
- * @param[out] equal: Are they equal?
+ * @return Are they equal?
  */
-static void PolyisEqHelp(const Poly *p, const Poly *q, bool *equal) {
+static bool PolyisEqHelp(const Poly *p, const Poly *q) {
     assert(p != NULL && q != NULL);
 
-    if (PolyIsCoeff(p)) {
-        if (!PolyIsCoeff(q)) {
-            *equal = false;
-        } else {
-            if (p->coeff != q->coeff) {
-                *equal = false;
-            }
-        }
-    } else {
-        if (PolyIsCoeff(q)) {
-            *equal = false;
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.p = p, .q = q});
+    bool equal = true;
+
+    while (equal && s.size > 0) {
+        frame f = framePop(&s);
+        if (PolyIsCoeff(f.p) || PolyIsCoeff(f.q)) {
+            equal = PolyIsCoeff(f.p) && PolyIsCoeff(f.q) && f.p->coeff == f.q->coeff;
+        } else if (PolyIsTerm(f.p) || PolyIsTerm(f.q)) {
+            unpacked u;
+            unpacked v;
+            const Poly *p1 = unpack(f.p, &u);
+            const Poly *q1 = unpack(f.q, &v);
+            const Poly *pFactor = &(PolyFactors(p1)[0]);
+            const Poly *qFactor = &(PolyFactors(q1)[0]);
+            equal = p1->size == 1 && q1->size == 1 && p1->exps[0] == q1->exps[0] &&
+                    PolyIsCoeff(pFactor) && PolyIsCoeff(qFactor) && pFactor->coeff == qFactor->coeff;
+        } else if (f.p->exps == f.q->exps) {
+            // The same memory block.
+        } else if (f.p->size != f.q->size ||
+                   memcmp(f.p->exps, f.q->exps, f.p->size * sizeof(poly_exp_t)) != 0) {
+            equal = false;
+        } else if (PolySimdAllCoeffs(f.p->size, PolyFactors(f.p))) {
+            equal = PolySimdIsEq(f.p->size, PolyFactors(f.p), PolyFactors(f.q));
         } else {
-            if (q->size != p->size) {
-                *equal = false;
-            } else {
-                for (size_t i = 0; i < p->size; ++i) {
-                    if (MonoGetExp(&(p->arr[i])) != MonoGetExp(&(q->arr[i]))) {
-                        *equal = false;
-                    }
-                    PolyisEqHelp(&(p->arr[i].p), &(q->arr[i].p), equal);
-                }
+            const Poly *pFactors = PolyFactors(f.p);
+            const Poly *qFactors = PolyFactors(f.q);
+            for (size_t i = 0; i < f.p->size; ++i) {
+                framePush(&s, (frame) {.p = &(pFactors[i]), .q = &(qFactors[i])});
             }
         }
     }
+
+    frameStackFree(&s);
+    return equal;
 }
 
 bool PolyIsEq(const Poly *p, const Poly *q) {
-    bool equal = true;
-
-    PolyisEqHelp(p, q, &equal);
-
-    return equal;
+    return PolyisEqHelp(p, q);
 }
 
 /**
@@ -541,11 +1291,12 @@ bool PolyIsEq(const Poly *p, const Poly *q) {
  * @return the number of monomials that will arise
  */
 static size_t countMonos(const Poly *p) {
+    const Poly *factors = PolyFactors(p);
     size_t count = 0;
 
     for (size_t i = 0; i < p->size; ++i) {
-        if (!PolyIsCoeff(&(p->arr[i].p))) {
-            count = count + p->arr[i].p.size;
+        if (!PolyIsCoeff(&(factors[i]))) {
+            count = count + PolyLength(&(factors[i]));
         } else {
             ++count;
         }
@@ -575,23 +1326,27 @@ static poly_coeff_t exponentiation(poly_coeff_t x, poly_exp_t n) {
  * @param[in] x : exponent
  */
 static void createMonos(Mono *monos, const Poly *p, poly_coeff_t x) {
+    const Poly *factors = PolyFactors(p);
     size_t i = 0;
     size_t j = 0;
 
     while (i < p->size) {
-        if (PolyIsCoeff(&(p->arr[i].p))) {
+        if (PolyIsCoeff(&(factors[i]))) {
             monos[j].exp = 0;
-            monos[j].p = PolyFromCoeff(p->arr[i].p.coeff * exponentiation(x,(p->arr[i].exp)));
+            monos[j].p = PolyFromCoeff(factors[i].coeff * exponentiation(x, p->exps[i]));
 
             ++j;
             ++i;
         } else {
-            for (size_t k = 0; k < p->arr[i].p.size ; ++k) {
-                monos[j].exp = MonoGetExp(&(p->arr[i].p.arr[k]));
+            unpacked u;
+            const Poly *factor = unpack(&(factors[i]), &u);
+            const Poly *inner = PolyFactors(factor);
+            for (size_t k = 0; k < factor->size ; ++k) {
+                monos[j].exp = factor->exps[k];
 
-                Poly r = PolyFromCoeff(exponentiation(x, (p->arr[i].exp)));
+                Poly r = PolyFromCoeff(exponentiation(x, p->exps[i]));
 
-                monos[j].p = PolyMul(&r,&(p->arr[i].p.arr[k].p));
+                monos[j].p = PolyMul(&r, &(inner[k]));
                 ++j;
             }
             ++i;
@@ -606,79 +1361,181 @@ Poly PolyAt(const Poly *p, poly_coeff_t x) {
         return *p;
     }
 
+    unpacked u;
+    p = unpack(p, &u);
     size_t count = countMonos(p);
 
-    Mono *monos = (Mono *) mallocSafe(count * sizeof(Mono));
+    Mono *monos = (Mono *) PolyMalloc(count * sizeof(Mono));
 
     createMonos(monos, p, x);
 
     Poly r = PolyAddMonos(count, monos);
 
-    free(monos);
+    PolyFree(monos);
 
     return r;
 }
 
-void PrintPoly(const Poly *p);
+/**
+ * The function prints the coefficient in decimal.
+ * @param[in] c : coefficient
+ */
+static void printCoeff(poly_coeff_t c) {
+#if POLY_COEFF_BITS <= 64
+    OutputLong((long) c);
+#else
+    char digits[48];
+    size_t i = sizeof(digits);
+    poly_ucoeff_t u = c < 0 ? 0 - (poly_ucoeff_t) c : (poly_ucoeff_t) c;
+
+    digits[--i] = 0;
+    do {
+        digits[--i] = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (c < 0) {
+        digits[--i] = '-';
+    }
+    OutputString(&(digits[i]));
+#endif
+}
 
 /**
- * The PrintMono function prints the monomial.
- * @param[in] m : monomial
+ * The function prints the single term, see PolyTerm.
+ * @param[in] p : single term
  */
-static void PrintMono(const Mono *m) {
-    printf("(");
-    PrintPoly(&(m->p));
-    printf(",%d)", m->exp);
+static void printTerm(const Poly *p) {
+    OutputChar('(');
+    printCoeff(p->coeff);
+    OutputChar(',');
+    OutputLong(PolyTermExp(p));
+    OutputChar(')');
 }
 
 void PrintPoly(const Poly *p) {
     if (PolyIsCoeff(p)) {
-        printf("%ld", p->coeff);
-    } else {
-        PrintMono(&(p->arr[0]));
-        for (size_t i = 1; i < p->size; ++i) {
-            printf("+");
-            PrintMono(&(p->arr[i]));
+        printCoeff(p->coeff);
+        return;
+    }
+    if (PolyIsTerm(p)) {
+        printTerm(p);
+        return;
+    }
+
+    frameStack s = frameStackInit();
+    framePush(&s, (frame) {.p = p, .next = 0});
+
+    while (s.size > 0) {
+        frame *f = &(s.frames[s.size - 1]);
+        if (f->next > 0) {
+            OutputChar(',');
+            OutputLong(f->p->exps[f->next - 1]);
+            OutputChar(')');
+        }
+        if (f->next == f->p->size) {
+            framePop(&s);
+        } else {
+            if (f->next > 0) {
+                OutputChar('+');
+            }
+            OutputChar('(');
+            const Poly *t = &(PolyFactors(f->p)[f->next]);
+            ++f->next;
+            if (PolyIsCoeff(t)) {
+                printCoeff(t->coeff);
+            } else if (PolyIsTerm(t)) {
+                printTerm(t);
+            } else {
+                framePush(&s, (frame) {.p = t, .next = 0});
+            }
         }
     }
+
+    frameStackFree(&s);
 }
 
 Poly PolyOwnMonos(size_t count, Mono *monos) {
     if (count == 0) {
-        if (monos != NULL) {
-            free (monos);
-        }
+        PolyFree(monos);
         return PolyZero();
     } else if (monos == NULL) {
         return PolyZero();
     } else {
-        Poly r;
-        r.arr = monos;
-        r.size = count;
-
-        PolyMonosClean(&r);
+        PolyMonosClean(&count, monos);
+        Poly r = packMonos(count, monos);
         PolyClean(&r);
 
         return r;
     }
 }
 
+/**
+ * The monosSorted function checks if the monomials are sorted by the exponent.
+ * @param[in] count : number of monomials
+ * @param[in] monos : table of monomials
+ * @return Are the monomials sorted?
+ */
+static bool monosSorted(size_t count, const Mono monos[]) {
+    for (size_t i = 1; i < count; ++i) {
+        if (MonoGetExp(&(monos[i - 1])) > MonoGetExp(&(monos[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Poly PolyOwnNormalMonos(size_t count, Mono *monos) {
+    if (count == 0 || monos == NULL) {
+        PolyFree(monos);
+        return PolyZero();
+    }
+
+    if (!monosSorted(count, monos)) {
+        qsort(monos, count, sizeof(Mono), compareMonos);
+    }
+
+    size_t k = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (k > 0 && MonoGetExp(&(monos[k - 1])) == MonoGetExp(&(monos[i]))) {
+            Poly t = PolyAdd(&(monos[k - 1].p), &(monos[i].p));
+            PolyDestroy(&(monos[k - 1].p));
+            PolyDestroy(&(monos[i].p));
+            monos[k - 1].p = t;
+        } else {
+            if (k > 0 && PolyIsCoeff(&(monos[k - 1].p)) && monos[k - 1].p.coeff == 0) {
+                --k;
+            }
+            monos[k] = monos[i];
+            ++k;
+        }
+    }
+    if (PolyIsCoeff(&(monos[k - 1].p)) && monos[k - 1].p.coeff == 0) {
+        --k;
+    }
+
+    if (k == 0) {
+        PolyFree(monos);
+        return PolyZero();
+    } else if (k == 1 && MonoGetExp(&(monos[0])) == 0 && PolyIsCoeff(&(monos[0].p))) {
+        Poly r = monos[0].p;
+        PolyFree(monos);
+        return r;
+    } else {
+        return packMonos(k, monos);
+    }
+}
+
 Poly PolyCloneMonos(size_t count, const Mono monos[]) {
     if (count == 0 || monos == NULL) {
         return PolyZero();
     } else {
-        Poly r;
-        r.arr = (Mono*) (count * sizeof (Mono));
-        r.size = count;
+        Mono *copy = (Mono *) PolyMalloc(count * sizeof(Mono));
 
         for (size_t i = 0; i < count; ++i) {
-            r.arr[i] = MonoClone(&(monos[i]));
+            copy[i] = MonoClone(&(monos[i]));
         }
 
-        PolyMonosClean(&r);
-        PolyClean(&r);
-
-        return r;
+        return PolyOwnMonos(count, copy);
     }
 }
 
@@ -726,20 +1583,22 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
     if (PolyIsCoeff(p)) {
         return *p;
     } else {
-      
-        Poly *polos = (Poly *) mallocSafe(p->size * sizeof(Poly));
+        unpacked u;
+        p = unpack(p, &u);
+        Poly *polos = (Poly *) PolyMalloc(p->size * sizeof(Poly));
+        const Poly *factors = PolyFactors(p);
 
         for (size_t j = 0; j < p->size; ++j) {
             if (k > 0) {
-                Poly t = PolyCompose(&(p->arr[j].p), k - 1, &(q[1]));
-                Poly r = PolyExp(&(q[0]), p->arr[j].exp);
+                Poly t = PolyCompose(&(factors[j]), k - 1, &(q[1]));
+                Poly r = PolyMemoExp(&(q[0]), p->exps[j]);
             
                 polos[j] = PolyMul(&r, &t); 
                 
                 PolyDestroy(&t);
                 PolyDestroy(&r);  
-            } else if (p->arr[j].exp == 0) {
-                polos[j] = PolyCompose(&(p->arr[j].p), 0, &(q[0]));
+            } else if (p->exps[j] == 0) {
+                polos[j] = PolyCompose(&(factors[j]), 0, &(q[0]));
             } else {
                 polos[j] = PolyZero();
             }
@@ -750,7 +1609,7 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
         for (size_t i = 0; i < p->size; ++i) {
             PolyDestroy(&(polos[i]));
         }
-        free(polos);
+        PolyFree(polos);
 
         return q;
     }
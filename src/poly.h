@@ -10,37 +10,90 @@
 #ifndef __POLY_H__
 #define __POLY_H__
 
+#include "polyAlloc.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 
+#ifndef POLY_COEFF_BITS
+/** This is the width of the coefficients in bits: 32, 64 or 128, see CMakeLists.txt. */
+#define POLY_COEFF_BITS 64
+#endif
+
+#ifndef POLY_EXP_BITS
+/** This is the width of the exponents in bits: 16 or 32, see CMakeLists.txt. */
+#define POLY_EXP_BITS 32
+#endif
+
+#if POLY_COEFF_BITS == 32
+/** This is a type representing coefficients. */
+typedef int32_t poly_coeff_t;
+/** This is the unsigned type of the width of the coefficients. */
+typedef uint32_t poly_ucoeff_t;
+/** This is the greatest coefficient. */
+#define POLY_COEFF_MAX INT32_MAX
+#elif POLY_COEFF_BITS == 64
 /** This is a type representing coefficients. */
 typedef long poly_coeff_t;
-
+/** This is the unsigned type of the width of the coefficients. */
+typedef unsigned long poly_ucoeff_t;
+/** This is the greatest coefficient. */
+#define POLY_COEFF_MAX LONG_MAX
+#elif POLY_COEFF_BITS == 128
+/** This is a type representing coefficients. */
+typedef __int128 poly_coeff_t;
+/** This is the unsigned type of the width of the coefficients. */
+typedef unsigned __int128 poly_ucoeff_t;
+/** This is the greatest coefficient. */
+#define POLY_COEFF_MAX ((poly_coeff_t) (~(poly_ucoeff_t) 0 >> 1))
+#else
+#error "POLY_COEFF_BITS has to be 32, 64 or 128"
+#endif
+
+#if POLY_EXP_BITS == 16
+/** This is a type representing exponent. */
+typedef int16_t poly_exp_t;
+/** This is the greatest exponent. */
+#define POLY_EXP_MAX INT16_MAX
+#elif POLY_EXP_BITS == 32
 /** This is a type representing exponent. */
 typedef int poly_exp_t;
+/** This is the greatest exponent. */
+#define POLY_EXP_MAX INT_MAX
+#else
+#error "POLY_EXP_BITS has to be 16 or 32"
+#endif
 
 struct Mono;
 
 /**
  * This is the structure representig polynomial.
- * Polynomial is either an integer (then 'arr == NULL'), 
- * or non-empty list of monomials (then `arr != NULL`).
+ * Polynomial is either an integer (then 'exps == NULL'),
+ * a single term with an integer factor kept inline (see PolyIsTerm),
+ * or non-empty list of monomials (then `exps` is a memory block).
  */
 typedef struct Poly {
   /**
   * This is the union that holds the coefficient of the polynomial or
   * the number of monomials in the polynomial.
-  * If `arr == NULL` then it is an integer coefficient.
+  * If `exps == NULL` then it is an integer coefficient.
+  * For a single term it is the integer factor of the term.
   * Otherwise, it is a non-empty list of monomials. 
   */
   union {
     poly_coeff_t coeff; ///< coefficient
     size_t       size; ///< number of monomials
   };
-  /** This is an array that holds a list of monomials */
-  struct Mono *arr;
+  /**
+   * This is the array of the exponents of the monomials in increasing order.
+   * The array of their factors follows it in the same memory block,
+   * see PolyFactors, so the exponents are scanned without touching the factors.
+   * For a single term it is the exponent, see PolyTerm.
+   */
+  poly_exp_t *exps;
 } Poly;
 
 /**
@@ -69,7 +122,7 @@ static inline poly_exp_t MonoGetExp(const Mono *m) {
  * @return polynomial
  */
 static inline Poly PolyFromCoeff(poly_coeff_t c) {
-  return (Poly) {.coeff = c, .arr = NULL};
+  return (Poly) {.coeff = c, .exps = NULL};
 }
 
 /**
@@ -100,7 +153,112 @@ static inline Mono MonoFromPoly(const Poly *p, poly_exp_t n) {
  * @return Is the polynomial a factor?
  */
 static inline bool PolyIsCoeff(const Poly *p) {
-  return p->arr == NULL;
+  return p->exps == NULL;
+}
+
+/**
+ * Creates a polynomial made of a single term @f$cx_i^e@f$. The term takes
+ * no memory: the factor is kept in `coeff` and the exponent in `exps`,
+ * shifted left and marked by the lowest bit, which no array has set.
+ * @param[in] c : factor of the term
+ * @param[in] e : exponent of the term
+ * @return polynomial @f$cx_i^e@f$
+ */
+static inline Poly PolyTerm(poly_coeff_t c, poly_exp_t e) {
+  return (Poly) {.coeff = c, .exps = (poly_exp_t *) (((uintptr_t) e << 1) | 1)};
+}
+
+/**
+ * Checks if the polynomial is a single term kept inline, see PolyTerm.
+ * Such a polynomial is not a factor, but it has no memory block,
+ * so PolyFactors must not be used on it.
+ * @param[in] p : polynomial
+ * @return Is the polynomial a single term?
+ */
+static inline bool PolyIsTerm(const Poly *p) {
+  return ((uintptr_t) p->exps & 1) != 0;
+}
+
+/**
+ * Gives the exponent of a single term, see PolyTerm.
+ * @param[in] p : single term
+ * @return exponent
+ */
+static inline poly_exp_t PolyTermExp(const Poly *p) {
+  return (poly_exp_t) ((uintptr_t) p->exps >> 1);
+}
+
+/**
+ * Gives the position of the factors in the memory block of the monomials:
+ * the size of the exponents rounded up to the alignment of a polynomial.
+ * @param[in] size : number of monomials
+ * @return offset of the factors in bytes
+ */
+static inline size_t PolyFactorsOffset(size_t size) {
+  return (size * sizeof(poly_exp_t) + _Alignof(Poly) - 1) / _Alignof(Poly) * _Alignof(Poly);
+}
+
+/**
+ * Gives the size of the memory block of the monomials.
+ * @param[in] size : number of monomials
+ * @return size in bytes
+ */
+static inline size_t PolyTermsBytes(size_t size) {
+  return PolyFactorsOffset(size) + size * sizeof(Poly);
+}
+
+/**
+ * Gives the array of the factors of the monomials of a polynomial
+ * which is neither a factor nor a single term.
+ * @param[in] p : polynomial
+ * @return array of factors
+ */
+static inline Poly *PolyFactors(const Poly *p) {
+  return (Poly *) ((char *) p->exps + PolyFactorsOffset(p->size));
+}
+
+/**
+ * Gives the number of monomials of a non-constant polynomial.
+ * @param[in] p : polynomial
+ * @return number of monomials
+ */
+static inline size_t PolyLength(const Poly *p) {
+  return PolyIsTerm(p) ? 1 : p->size;
+}
+
+/**
+ * Gives the exponent of a monomial of a non-constant polynomial.
+ * @param[in] p : polynomial
+ * @param[in] i : index of the monomial
+ * @return exponent
+ */
+static inline poly_exp_t PolyGetExp(const Poly *p, size_t i) {
+  return PolyIsTerm(p) ? PolyTermExp(p) : p->exps[i];
+}
+
+/**
+ * Gives the monomial of a non-constant polynomial.
+ * The factor of the monomial still belongs to the polynomial.
+ * @param[in] p : polynomial
+ * @param[in] i : index of the monomial
+ * @return monomial
+ */
+static inline Mono PolyGetMono(const Poly *p, size_t i) {
+  if (PolyIsTerm(p)) {
+    return (Mono) {.p = PolyFromCoeff(p->coeff), .exp = PolyTermExp(p)};
+  }
+  return (Mono) {.p = PolyFactors(p)[i], .exp = p->exps[i]};
+}
+
+/**
+ * Frees the memory block of the monomials of a non-constant polynomial,
+ * but not their factors, e.g. after they are taken out by PolyGetMono.
+ * @param[in] p : polynomial
+ */
+static inline void PolyFreeMonos(const Poly *p) {
+  if (!PolyIsTerm(p)) {
+    PolyFree(p->exps);
+  }
 }
 
 /**
@@ -124,6 +282,57 @@ static inline void MonoDestroy(Mono *m) {
   PolyDestroy(&m->p);
 }
 
+/**
+ * Counts the monomials of a polynomial on all levels of nesting.
+ * Counting stops as soon as @p limit monomials have been seen.
+ * @param[in] p : polynomial
+ * @param[in] limit : upper bound of the result
+ * @return number of monomials, but not more than @p limit
+ */
+size_t PolyCountMonos(const Poly *p, size_t limit);
+
+/**
+ * These are the sizes of a polynomial.
+ */
+typedef struct {
+  size_t terms; ///< number of monomials on all levels of nesting
+  size_t nodes; ///< number of polynomials which are not coefficients
+  size_t depth; ///< number of levels of nesting, 0 for a coefficient
+  size_t bytes; ///< memory of the monomials, the single terms take none
+} PolySizes;
+
+/**
+ * Measures the polynomial.
+ * @param[in] p : polynomial
+ * @return sizes of the polynomial
+ */
+PolySizes PolyMeasure(const Poly *p);
+
+/**
+ * These are the kernels of the library which can be probed, see PolySetProbes.
+ */
+typedef enum {
+  POLY_KERNEL_MUL,   ///< multiplication of two polynomials which are not coefficients
+  POLY_KERNEL_CLEAN, ///< sorting and merging of an array of monomials
+  POLY_KERNELS       ///< number of the kernels
+} PolyKernel;
+
+/**
+ * These are the functions called when a kernel is entered and left.
+ * The kernels are recursive, so the calls nest.
+ */
+typedef struct {
+  void (*enter)(PolyKernel kernel); ///< called when the kernel starts
+  void (*leave)(PolyKernel kernel); ///< called when the kernel ends
+} PolyProbes;
+
+/**
+ * Sets the probes of the kernels. Like PolySetAllocator, it has to be called
+ * before any polynomial is created.
+ * @param[in] probes : probes, NULL for none
+ */
+void PolySetProbes(const PolyProbes *probes);
+
 /**
  * Make a full deep copy of a polynomial.
  * @param[in] p : polynomial
@@ -165,6 +374,26 @@ Poly PolyAddMonos(size_t count, const Mono monos[]);
  */
 Poly PolyMul(const Poly *p, const Poly *q);
 
+/**
+ * Multiplies two polynomials and keeps only the monomials of total degree
+ * at most @p deg. Monomials above the bound are never generated.
+ * @param[in] p : polynomial @f$p@f$
+ * @param[in] q : polynomial @f$q@f$
+ * @param[in] deg : degree bound
+ * @return @f$p * q@f$ truncated to total degree @p deg
+ */
+Poly PolyMulTrunc(const Poly *p, const Poly *q, poly_exp_t deg);
+
+/**
+ * Exponentiates a polynomial and keeps only the monomials of total degree
+ * at most @p deg. Every intermediate product is truncated as well.
+ * @param[in] p : polynomial @f$p@f$
+ * @param[in] exp : power
+ * @param[in] deg : degree bound
+ * @return @f$p^{exp}@f$ truncated to total degree @p deg
+ */
+Poly PolyExpTrunc(const Poly *p, poly_exp_t exp, poly_exp_t deg);
+
 /**
  * Returns the opposite polynomial.
  * @param[in] p : polynomial @f$p@f$
@@ -222,6 +451,7 @@ Poly PolyAt(const Poly *p, poly_coeff_t x);
 
 /**
  * The function prints the polynomial.
+ * The polynomial is appended to the buffered output, see output.h.
  * @param[in] p : polynomial
  */
 void PrintPoly(const Poly *p);
@@ -238,6 +468,20 @@ void PrintPoly(const Poly *p);
  */
 Poly PolyOwnMonos(size_t count, Mono *monos);
 
+/**
+ * Sums a list of monomials whose coefficients are already simplified
+ * polynomials (for example results of other functions of this interface)
+ * and forms a polynomial from them. Takes over ownership of the memory
+ * pointed to by @p monos and its contents. Only the outermost level is
+ * simplified, so the cost does not depend on the depth of the coefficients.
+ * If @p count or @p monos is zero (NULL), creates a polynomial
+ * identically equal to zero.
+ * @param[in] count : number of monomials
+ * @param[in] monos : table of monomials
+ * @return polynomial being the sum of monomials
+ */
+Poly PolyOwnNormalMonos(size_t count, Mono *monos);
+
 /**
  * Sums a list of monomials and forms a polynomial from them. Does not modify the content
  * array @p monos. If required, it makes complete copies of monomials
@@ -0,0 +1,334 @@
+/** @file
+  Implementation of the memory allocation of the polynomial library.
+  Inside PolyRun every allocation is written down in the journal of the task,
+  a hash set of the pointers, and crossed out when it is freed. When an
+  allocation fails, the task is left by longjmp and the pointers still
+  in the journal are exactly the memory the task has to give back.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "polyAlloc.h"
+#include "polyMemo.h"
+#include <malloc.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * This is the journal of the memory allocated by a task of PolyRun.
+ */
+typedef struct journal {
+    void **slots;             ///< hash set of the pointers, NULL for an empty slot
+    size_t capacity;          ///< number of slots, a power of two
+    size_t count;             ///< number of pointers
+    jmp_buf jump;             ///< place to return to when an allocation fails
+    struct journal *outer;    ///< journal of the enclosing task
+} journal;
+
+/** The allocation functions of the library. */
+static PolyAllocator allocator = {.malloc = malloc, .realloc = realloc, .free = free};
+
+/** The journal of the innermost task of the calling thread, NULL outside of tasks. */
+static _Thread_local journal *active = NULL;
+
+/** Is the memory counted? It does not change once polynomials exist. */
+static bool counting = false;
+
+/** @name Memory counters
+ * They are shared by the threads, see PolyMemoryCounters.
+ */
+///@{
+static atomic_size_t allocations;   ///< number of allocations
+static atomic_size_t bytes;         ///< bytes allocated in total
+static atomic_size_t live;          ///< bytes not freed yet
+static atomic_size_t peak;          ///< greatest number of live bytes
+///@}
+
+void PolySetAllocator(const PolyAllocator *Allocator) {
+    if (Allocator == NULL) {
+        allocator = (PolyAllocator) {.malloc = malloc, .realloc = realloc, .free = free};
+    } else {
+        allocator = *Allocator;
+    }
+}
+
+void PolyCountMemory(void) {
+    counting = true;
+}
+
+void PolyGetMemoryCounters(PolyMemoryCounters *counters) {
+    counters->allocations = atomic_load_explicit(&allocations, memory_order_relaxed);
+    counters->bytes = atomic_load_explicit(&bytes, memory_order_relaxed);
+    counters->live = atomic_load_explicit(&live, memory_order_relaxed);
+    counters->peak = atomic_load_explicit(&peak, memory_order_relaxed);
+}
+
+/**
+ * The function gives the size of the allocated block, if it is known.
+ * @param[in] pointer : allocated memory or NULL
+ * @return number of bytes, 0 if it is not known
+ */
+static size_t blockSize(void *pointer) {
+    return pointer != NULL && allocator.malloc == malloc ? malloc_usable_size(pointer) : 0;
+}
+
+/**
+ * The function counts the allocated block, which replaces
+ * the block of the given size.
+ * @param[in] pointer : allocated memory
+ * @param[in] before : size of the replaced block, 0 if there is none
+ */
+static void countAllocation(void *pointer, size_t before) {
+    size_t size = blockSize(pointer);
+
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes, size, memory_order_relaxed);
+    size_t now = atomic_fetch_add_explicit(&live, size - before, memory_order_relaxed) +
+                 (size - before);
+    size_t highest = atomic_load_explicit(&peak, memory_order_relaxed);
+    while (now > highest &&
+           !atomic_compare_exchange_weak_explicit(&peak, &highest, now, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+/**
+ * The function gives the first slot to look for the pointer in.
+ * @param[in] J : journal
+ * @param[in] pointer : pointer
+ * @return index of the slot
+ */
+static size_t home(const journal *J, const void *pointer) {
+    uint64_t h = (uint64_t) (uintptr_t) pointer * 0x9E3779B97F4A7C15ULL;
+
+    return (size_t) (h >> 32) & (J->capacity - 1);
+}
+
+/**
+ * The function puts the pointer into the slots, which have room for it.
+ * @param[in,out] J : journal
+ * @param[in] pointer : pointer
+ */
+static void place(journal *J, void *pointer) {
+    size_t i = home(J, pointer);
+    while (J->slots[i] != NULL) {
+        i = (i + 1) & (J->capacity - 1);
+    }
+    J->slots[i] = pointer;
+    ++J->count;
+}
+
+/**
+ * The function makes room for the given number of pointers in the journal.
+ * @param[in,out] J : journal
+ * @param[in] count : number of pointers
+ * @return Is there room?
+ */
+static bool reserve(journal *J, size_t count) {
+    if (2 * count < J->capacity) {
+        return true;
+    }
+
+    size_t capacity = J->capacity == 0 ? 64 : J->capacity;
+    while (2 * count >= capacity) {
+        capacity *= 2;
+    }
+    void **slots = (void **) allocator.malloc(capacity * sizeof(void *));
+    if (slots == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i] = NULL;
+    }
+
+    void **old = J->slots;
+    size_t oldCapacity = J->capacity;
+    J->slots = slots;
+    J->capacity = capacity;
+    J->count = 0;
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (old[i] != NULL) {
+            place(J, old[i]);
+        }
+    }
+    allocator.free(old);
+
+    return true;
+}
+
+/**
+ * The function crosses the pointer out of the journal, if it is there.
+ * @param[in,out] J : journal
+ * @param[in] pointer : pointer
+ */
+static void forget(journal *J, const void *pointer) {
+    if (J->count == 0) {
+        return;
+    }
+
+    size_t mask = J->capacity - 1;
+    size_t i = home(J, pointer);
+    while (J->slots[i] != pointer) {
+        if (J->slots[i] == NULL) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    J->slots[i] = NULL;
+    --J->count;
+
+    // The following pointers of the run are shifted back, so no search
+    // stops at the emptied slot too early.
+    for (size_t j = (i + 1) & mask; J->slots[j] != NULL; j = (j + 1) & mask) {
+        size_t k = home(J, J->slots[j]);
+        if (((j - k) & mask) >= ((j - i) & mask)) {
+            J->slots[i] = J->slots[j];
+            J->slots[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+/**
+ * The function frees the memory allocated for the library.
+ * @param[in] pointer : allocated memory or NULL
+ */
+static void release(void *pointer) {
+    if (counting) {
+        atomic_fetch_sub_explicit(&live, blockSize(pointer), memory_order_relaxed);
+    }
+    allocator.free(pointer);
+}
+
+/**
+ * The function handles a failed allocation: it stops the innermost task
+ * or terminates the program outside of tasks.
+ */
+static void failure(void) {
+    if (active != NULL) {
+        longjmp(active->jump, 1);
+    }
+    exit(1);
+}
+
+/**
+ * The function writes the new memory down in the journal of the task.
+ * If there is no room for it, the memory is freed and the task is stopped.
+ * @param[in] pointer : allocated memory
+ */
+static void record(void *pointer) {
+    if (active != NULL && pointer != NULL) {
+        if (!reserve(active, active->count + 1)) {
+            release(pointer);
+            failure();
+        }
+        place(active, pointer);
+    }
+}
+
+void *PolyMalloc(size_t size) {
+    void *pointer = allocator.malloc(size);
+    if (pointer == NULL && size > 0) {
+        failure();
+    }
+    if (counting) {
+        countAllocation(pointer, 0);
+    }
+    record(pointer);
+
+    return pointer;
+}
+
+void *PolyRealloc(void *pointer, size_t size) {
+    size_t before = counting ? blockSize(pointer) : 0;
+    void *moved = allocator.realloc(pointer, size);
+    if (moved == NULL && size > 0) {
+        failure();
+    }
+    if (counting) {
+        countAllocation(moved, before);
+    }
+    if (moved != pointer) {
+        for (journal *J = active; J != NULL && pointer != NULL; J = J->outer) {
+            forget(J, pointer);
+        }
+        record(moved);
+    }
+
+    return moved;
+}
+
+void PolyKeep(void *pointer) {
+    for (journal *J = active; J != NULL && pointer != NULL; J = J->outer) {
+        forget(J, pointer);
+    }
+}
+
+void PolyFree(void *pointer) {
+    if (pointer == NULL) {
+        return;
+    }
+    for (journal *J = active; J != NULL; J = J->outer) {
+        forget(J, pointer);
+    }
+    release(pointer);
+}
+
+/**
+ * The function frees the journal and, if asked, the memory written in it.
+ * @param[in] J : journal
+ * @param[in] all : Should the memory be freed?
+ */
+static void freeJournal(journal *J, bool all) {
+    for (size_t i = 0; all && i < J->capacity; ++i) {
+        if (J->slots[i] != NULL) {
+            release(J->slots[i]);
+        }
+    }
+    allocator.free(J->slots);
+    allocator.free(J);
+}
+
+PolyError PolyRun(void (*task)(void *argument), void *argument) {
+    journal *J = (journal *) allocator.malloc(sizeof(journal));
+    if (J == NULL) {
+        return POLY_NO_MEMORY;
+    }
+    J->slots = NULL;
+    J->capacity = 0;
+    J->count = 0;
+    J->outer = active;
+    active = J;
+
+    if (setjmp(J->jump) == 0) {
+        task(argument);
+        active = J->outer;
+
+        // The memory left by the task belongs to the enclosing task now.
+        if (active != NULL) {
+            if (!reserve(active, active->count + J->count)) {
+                freeJournal(J, true);
+                failure();
+            }
+            for (size_t i = 0; i < J->capacity; ++i) {
+                if (J->slots[i] != NULL) {
+                    place(active, J->slots[i]);
+                }
+            }
+        }
+        freeJournal(J, false);
+
+        return POLY_OK;
+    }
+
+    // The cache may hold the results computed by the task.
+    PolyMemoClear();
+    active = J->outer;
+    freeJournal(J, true);
+
+    return POLY_NO_MEMORY;
+}
@@ -0,0 +1,110 @@
+/** @file
+  Interface of the memory allocation of the polynomial library
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __POLYALLOC_H__
+#define __POLYALLOC_H__
+
+#include <stddef.h>
+
+/**
+ * These are the error codes of the polynomial library.
+ */
+typedef enum {
+    POLY_OK,          ///< success
+    POLY_NO_MEMORY    ///< an allocation failed
+} PolyError;
+
+/**
+ * This is the set of functions allocating the memory of the library.
+ * They have the meaning of the standard malloc, realloc and free
+ * and they may be called by many threads at once.
+ */
+typedef struct {
+    void *(*malloc)(size_t size);                   ///< allocation
+    void *(*realloc)(void *pointer, size_t size);   ///< reallocation
+    void (*free)(void *pointer);                    ///< release
+} PolyAllocator;
+
+/**
+ * The function sets the functions allocating the memory of the library.
+ * It has to be called before any polynomial is created.
+ * The arrays of monomials passed to the library or taken from it
+ * have to be allocated and freed by PolyMalloc and PolyFree then.
+ * @param[in] allocator : allocation functions, NULL for the standard ones
+ */
+void PolySetAllocator(const PolyAllocator *allocator);
+
+/**
+ * These are the counters of the memory of the library.
+ */
+typedef struct {
+    size_t allocations;   ///< number of allocations and reallocations
+    size_t bytes;         ///< number of bytes allocated in total
+    size_t live;          ///< number of bytes allocated and not freed yet
+    size_t peak;          ///< greatest number of live bytes so far
+} PolyMemoryCounters;
+
+/**
+ * The function starts counting the memory of the library. Like PolySetAllocator
+ * it has to be called before any polynomial is created. The bytes are the sizes
+ * of the blocks given by the standard allocator, with other allocation functions
+ * only the allocations are counted.
+ */
+void PolyCountMemory(void);
+
+/**
+ * The function gives the counters of the memory of all the threads,
+ * they are zero if the memory is not counted.
+ * @param[out] counters : counters
+ */
+void PolyGetMemoryCounters(PolyMemoryCounters *counters);
+
+/**
+ * The function allocates @p size bytes. If the allocation fails inside
+ * PolyRun, the task is stopped, otherwise the program is terminated with code 1.
+ * @param[in] size : number of bytes
+ * @return pointer
+ */
+void *PolyMalloc(size_t size);
+
+/**
+ * The function changes the size of the allocated memory, like PolyMalloc
+ * it never returns on a failure.
+ * @param[in] pointer : allocated memory or NULL
+ * @param[in] size : number of bytes
+ * @return pointer
+ */
+void *PolyRealloc(void *pointer, size_t size);
+
+/**
+ * The function frees the memory allocated by PolyMalloc or PolyRealloc.
+ * @param[in] pointer : allocated memory or NULL
+ */
+void PolyFree(void *pointer);
+
+/**
+ * The function takes the memory allocated by PolyMalloc or PolyRealloc
+ * out of the tasks of the calling thread, see PolyRun,
+ * so it is not freed when they are stopped.
+ * @param[in] pointer : allocated memory or NULL
+ */
+void PolyKeep(void *pointer);
+
+/**
+ * The function performs the task, which calls the functions of the library.
+ * If an allocation fails, the task is stopped at once, the memory it has
+ * allocated and not freed is freed, the cache of the calling thread
+ * is emptied, see polyMemo.h, and the error is returned. So the task should
+ * only read the polynomials that existed before and write its results
+ * when they are complete. The tasks may be nested.
+ * @param[in] task : task
+ * @param[in,out] argument : argument of the task
+ * @return POLY_OK or POLY_NO_MEMORY
+ */
+PolyError PolyRun(void (*task)(void *argument), void *argument);
+
+#endif /* __POLYALLOC_H__ */
@@ -0,0 +1,232 @@
+/** @file
+  Test of the recovery of PolyRun from failed allocations. The allocator
+  of the library fails the N-th allocation, for N = 1, 2, ... until a run
+  of the task allocates less. Every stopped run must return POLY_NO_MEMORY
+  and give back all its memory, the complete run must give the result
+  computed without failures, less the part of the inner task if that one
+  was stopped. The test is meant to be run under the sanitizers
+  too, e.g. built with -fsanitize=address or -fsanitize=thread.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "output.h"
+#include "poly.h"
+#include "polyMemo.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/** The number of allocations so far. */
+static size_t calls = 0;
+
+/** The number of the allocation which fails, 0 for none. */
+static size_t failAt = 0;
+
+/** The number of blocks allocated and not freed. */
+static long live = 0;
+
+/**
+ * The function allocates memory, unless it is the allocation which fails.
+ * @param[in] size : number of bytes
+ * @return pointer or NULL
+ */
+static void *testMalloc(size_t size) {
+    if (++calls == failAt) {
+        return NULL;
+    }
+    void *pointer = malloc(size);
+    if (pointer != NULL) {
+        ++live;
+    }
+    return pointer;
+}
+
+/**
+ * The function reallocates memory, unless it is the allocation which fails.
+ * @param[in] pointer : allocated memory or NULL
+ * @param[in] size : number of bytes
+ * @return pointer or NULL
+ */
+static void *testRealloc(void *pointer, size_t size) {
+    if (++calls == failAt) {
+        return NULL;
+    }
+    void *moved = realloc(pointer, size);
+    if (moved != NULL && pointer == NULL) {
+        ++live;
+    }
+    return moved;
+}
+
+/**
+ * The function frees memory.
+ * @param[in] pointer : allocated memory or NULL
+ */
+static void testFree(void *pointer) {
+    if (pointer != NULL) {
+        --live;
+    }
+    free(pointer);
+}
+
+/**
+ * The function gives the polynomial @f$c x_i^e@f$ times the factor.
+ * @param[in] c : coefficient of the factor
+ * @param[in] e : exponent
+ * @param[in] factor : factor, NULL for 1
+ * @return polynomial
+ */
+static Poly term(poly_coeff_t c, poly_exp_t e, const Poly *factor) {
+    Poly coeff = PolyFromCoeff(c);
+    Poly inner = factor == NULL ? coeff : PolyMul(factor, &coeff);
+    Mono m = MonoFromPoly(&inner, e);
+
+    return PolyAddMonos(1, &m);
+}
+
+/**
+ * This is the argument of the tasks.
+ */
+typedef struct {
+    const Poly *p;   ///< polynomial
+    const Poly *q;   ///< polynomial
+    Poly result;     ///< result of the task
+    Poly part;       ///< result of the inner task, zero if it was stopped
+    bool stopped;    ///< was the inner task stopped?
+} work;
+
+/**
+ * The inner task, performed inside the outer one.
+ * @param[in,out] argument : work
+ */
+static void inner(void *argument) {
+    work *W = (work *) argument;
+
+    Poly d = PolySub(W->p, W->q);
+    W->result = PolyExpTrunc(&d, 4, 9);
+    PolyDestroy(&d);
+}
+
+/**
+ * The outer task, it uses the main kernels of the library.
+ * @param[in,out] argument : work
+ */
+static void outer(void *argument) {
+    work *W = (work *) argument;
+    Poly both[2] = {*(W->p), *(W->q)};
+
+    Poly product = PolyMul(W->p, W->q);
+    Poly memo = PolyMemoMul(W->p, W->q);
+    Poly composed = PolyCompose(&product, 2, both);
+    Poly at = PolyAt(&composed, 3);
+    Poly power = PolyExp(W->q, 3);
+    Poly trunc = PolyMulTrunc(&power, W->p, 10);
+    Poly negated = PolyNeg(&trunc);
+
+    // A stopped inner task only leaves its part out.
+    work Inner = {.p = W->p, .q = &negated};
+    W->stopped = PolyRun(inner, &Inner) != POLY_OK;
+    if (W->stopped) {
+        Inner.result = PolyZero();
+    }
+    W->part = PolyClone(&(Inner.result));
+
+    Poly sums[6] = {memo, composed, at, power, negated, Inner.result};
+    Poly result = PolyClone(&product);
+    for (size_t i = 0; i < 6; ++i) {
+        Poly next = PolyAdd(&result, &(sums[i]));
+        PolyDestroy(&result);
+        PolyDestroy(&(sums[i]));
+        result = next;
+    }
+    PolyDestroy(&product);
+    PolyDestroy(&trunc);
+
+    PrintPoly(&result);
+    OutputChar('\n');
+    W->result = result;
+}
+
+/**
+ * The function runs the outer task for every allocation failing in turn.
+ * @return 0 if the test passes, 1 otherwise
+ */
+int main(void) {
+    PolyAllocator allocator = {.malloc = testMalloc, .realloc = testRealloc, .free = testFree};
+    PolySetAllocator(&allocator);
+    PolyMemoStart(1 << 20);
+
+    // The printed polynomials are not looked at.
+    int null = open("/dev/null", O_WRONLY);
+    if (null < 0 || dup2(null, STDOUT_FILENO) < 0) {
+        return 1;
+    }
+    close(null);
+
+    Poly x = term(2, 3, NULL);
+    Poly y = term(-1, 2, &x);
+    Poly z = term(3, 1, NULL);
+    Poly p = PolyAdd(&y, &z);
+    Poly q = PolySub(&x, &p);
+    PolyDestroy(&x);
+    PolyDestroy(&y);
+    PolyDestroy(&z);
+
+    work Expected = {.p = &p, .q = &q};
+    if (PolyRun(outer, &Expected) != POLY_OK || Expected.stopped) {
+        return 1;
+    }
+    PolyMemoClear();
+    long before = live;
+
+    // Only the allocations of the task fail, not the ones of the checks.
+    int errors = 0;
+    size_t stopped = 0;
+    size_t n;
+    for (n = 1; ; ++n) {
+        calls = 0;
+        failAt = n;
+        work W = {.p = &p, .q = &q};
+        PolyError error = PolyRun(outer, &W);
+        bool failed = calls >= n;
+        failAt = 0;
+
+        if (error == POLY_OK) {
+            Poly result = W.stopped ? PolyAdd(&(W.result), &(Expected.part)) : PolyClone(&(W.result));
+            if (!PolyIsEq(&result, &(Expected.result))) {
+                fprintf(stderr, "allocation %zu: wrong result\n", n);
+                ++errors;
+            }
+            PolyDestroy(&result);
+            PolyDestroy(&(W.result));
+            PolyDestroy(&(W.part));
+        } else if (!failed) {
+            fprintf(stderr, "allocation %zu: failure without a failed allocation\n", n);
+            ++errors;
+        } else {
+            ++stopped;
+        }
+        PolyMemoClear();
+        if (live != before) {
+            fprintf(stderr, "allocation %zu: %ld blocks not given back\n", n, live - before);
+            ++errors;
+            before = live;
+        }
+        if (!failed) {
+            break;
+        }
+    }
+
+    PolyDestroy(&(Expected.result));
+    PolyDestroy(&(Expected.part));
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyMemoStop();
+    OutputFlush();
+
+    fprintf(stderr, "%zu allocations, %zu runs stopped, %d errors\n", n - 1, stopped, errors);
+    return errors == 0 ? 0 : 1;
+}
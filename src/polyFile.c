@@ -0,0 +1,498 @@
+/** @file
+  Implementation of the binary files of polynomials.
+  Both directions walk the polynomial with an explicit stack, so the depth
+  of a polynomial is limited only by the memory.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "polyFile.h"
+#include "mallocSafe.h"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The size of the write buffer.
+ */
+#define FILE_BUFFER (1 << 20)
+
+/**
+ * The version of the format.
+ */
+#define FILE_VERSION 1
+
+/**
+ * The size of the header: four magic bytes, the version and the size of a coefficient.
+ */
+#define HEADER_SIZE 6
+
+/**
+ * This is the element of the stack of a walk over a polynomial.
+ */
+typedef struct {
+    Poly *p;      ///< polynomial
+    size_t next;  ///< index of the next monomial
+} fileFrame;
+
+/**
+ * This is the stack of a walk over a polynomial.
+ */
+typedef struct {
+    fileFrame *frames;  ///< elements
+    size_t size;        ///< number of elements
+    size_t capacity;    ///< size of the array
+} fileStack;
+
+/**
+ * The function puts an element on the stack.
+ * @param[in,out] s : stack
+ * @param[in] p : polynomial
+ */
+static void filePush(fileStack *s, Poly *p) {
+    if (s->size == s->capacity) {
+        s->capacity = 2 * s->capacity + 16;
+        s->frames = (fileFrame *) realloc(s->frames, s->capacity * sizeof(fileFrame));
+        if (s->frames == NULL) {
+            exit(1);
+        }
+    }
+    s->frames[s->size] = (fileFrame) {.p = p, .next = 0};
+    ++s->size;
+}
+
+/**
+ * This is the buffered writer of a file.
+ */
+typedef struct {
+    int fd;          ///< file descriptor
+    char *buffer;    ///< buffer
+    size_t used;     ///< number of bytes in the buffer
+    bool correct;    ///< have all the writes succeeded?
+} writer;
+
+/**
+ * The function writes out the buffer.
+ * @param[in,out] Writer : writer
+ */
+static void flush(writer *Writer) {
+    const char *letters = Writer->buffer;
+    size_t count = Writer->used;
+
+    while (count > 0 && Writer->correct) {
+        ssize_t written = write(Writer->fd, letters, count);
+        if (written < 0) {
+            Writer->correct = errno == EINTR;
+        } else {
+            letters += written;
+            count -= (size_t) written;
+        }
+    }
+    Writer->used = 0;
+}
+
+/**
+ * The function appends a number written as a varint: seven bits per byte,
+ * the lowest first, the highest bit set in every byte but the last.
+ * @param[in,out] Writer : writer
+ * @param[in] x : number
+ */
+static void putVarint(writer *Writer, unsigned long long x) {
+    if (FILE_BUFFER - Writer->used < 10) {
+        flush(Writer);
+    }
+    while (x >= 0x80) {
+        Writer->buffer[Writer->used++] = (char) (x | 0x80);
+        x >>= 7;
+    }
+    Writer->buffer[Writer->used++] = (char) x;
+}
+
+/**
+ * The function appends a coefficient in fixed width.
+ * @param[in,out] Writer : writer
+ * @param[in] c : coefficient
+ */
+static void putCoeff(writer *Writer, poly_coeff_t c) {
+    poly_ucoeff_t u = (poly_ucoeff_t) c;
+
+    if (FILE_BUFFER - Writer->used < sizeof(poly_coeff_t)) {
+        flush(Writer);
+    }
+    for (size_t i = 0; i < sizeof(poly_coeff_t); ++i) {
+        Writer->buffer[Writer->used++] = (char) (u >> (8 * i));
+    }
+}
+
+/**
+ * The function appends the beginning of a polynomial: a coefficient
+ * or the number of monomials. The polynomial is put on the stack
+ * if it has monomials.
+ * @param[in,out] Writer : writer
+ * @param[in,out] s : stack
+ * @param[in] p : polynomial
+ */
+static void putPoly(writer *Writer, fileStack *s, const Poly *p) {
+    if (PolyIsCoeff(p)) {
+        putVarint(Writer, 0);
+        putCoeff(Writer, p->coeff);
+    } else if (PolyIsTerm(p)) {
+        // A single term is written like a monomial with its coefficient.
+        putVarint(Writer, 1);
+        putVarint(Writer, (unsigned long long) PolyTermExp(p));
+        putVarint(Writer, 0);
+        putCoeff(Writer, p->coeff);
+    } else {
+        putVarint(Writer, p->size);
+        filePush(s, (Poly *) p);
+    }
+}
+
+/**
+ * The function appends the header of a file.
+ * @param[in,out] Writer : writer
+ * @param[in] magic : first four bytes of the file
+ */
+static void putHeader(writer *Writer, const char *magic) {
+    memcpy(Writer->buffer + Writer->used, magic, 4);
+    Writer->buffer[Writer->used + 4] = FILE_VERSION;
+    Writer->buffer[Writer->used + 5] = (char) sizeof(poly_coeff_t);
+    Writer->used += HEADER_SIZE;
+}
+
+/**
+ * The function appends a polynomial in pre-order.
+ * @param[in,out] Writer : writer
+ * @param[in,out] s : empty stack
+ * @param[in] p : polynomial
+ */
+static void putTree(writer *Writer, fileStack *s, const Poly *p) {
+    putPoly(Writer, s, p);
+    while (s->size > 0) {
+        fileFrame *f = &(s->frames[s->size - 1]);
+        if (f->next == f->p->size) {
+            --s->size;
+        } else {
+            size_t i = f->next++;
+            putVarint(Writer, (unsigned long long) f->p->exps[i]);
+            putPoly(Writer, s, &(PolyFactors(f->p)[i]));
+        }
+    }
+}
+
+/**
+ * The function writes the polynomials to a file.
+ * @param[in] magic : first four bytes of the file
+ * @param[in] many : should the number of polynomials be written?
+ * @param[in] count : number of polynomials
+ * @param[in] polys : array of polynomials
+ * @param[in] fd : file descriptor
+ * @return Have the polynomials been written?
+ */
+static bool writeFile(const char *magic, bool many, size_t count, const Poly polys[], int fd) {
+    writer Writer = {.fd = fd, .used = 0, .correct = true};
+    fileStack s = {.frames = NULL, .size = 0, .capacity = 0};
+
+    Writer.buffer = (char *) mallocSafe(FILE_BUFFER);
+    putHeader(&Writer, magic);
+    if (many) {
+        putVarint(&Writer, count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        putTree(&Writer, &s, &(polys[i]));
+    }
+    flush(&Writer);
+
+    free(s.frames);
+    free(Writer.buffer);
+
+    return Writer.correct;
+}
+
+bool PolyWriteFile(const Poly *p, int fd) {
+    return writeFile("POLY", false, 1, p, fd);
+}
+
+bool PolyWriteStackFile(size_t count, const Poly polys[], int fd) {
+    return writeFile("PSTK", true, count, polys, fd);
+}
+
+/**
+ * This is the reader of the bytes of a file.
+ */
+typedef struct {
+    const unsigned char *bytes;  ///< contents of the file
+    size_t size;                 ///< size of the file
+    size_t position;             ///< position of the next byte
+} reader;
+
+/**
+ * The function reads a varint.
+ * @param[in,out] Reader : reader
+ * @param[out] x : number
+ * @return Is the number correct?
+ */
+static bool getVarint(reader *Reader, unsigned long long *x) {
+    unsigned long long result = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (Reader->position == Reader->size) {
+            return false;
+        }
+        unsigned char byte = Reader->bytes[Reader->position++];
+        result |= (unsigned long long) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *x = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * The function reads a coefficient.
+ * @param[in,out] Reader : reader
+ * @param[out] c : coefficient
+ * @return Is the coefficient correct?
+ */
+static bool getCoeff(reader *Reader, poly_coeff_t *c) {
+    poly_ucoeff_t u = 0;
+
+    if (Reader->size - Reader->position < sizeof(poly_coeff_t)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(poly_coeff_t); ++i) {
+        u |= (poly_ucoeff_t) Reader->bytes[Reader->position++] << (8 * i);
+    }
+    *c = (poly_coeff_t) u;
+
+    return true;
+}
+
+/**
+ * The function reads the beginning of a polynomial. If the polynomial has
+ * monomials, their array is allocated, filled with zeros and the polynomial
+ * is put on the stack, so a polynomial read in part can always be destroyed.
+ * @param[in,out] Reader : reader
+ * @param[in,out] s : stack
+ * @param[out] p : polynomial
+ * @param[in] inner : is the polynomial a coefficient of a monomial?
+ * @return Is the polynomial correct so far?
+ */
+static bool getPoly(reader *Reader, fileStack *s, Poly *p, bool inner) {
+    unsigned long long size;
+
+    if (!getVarint(Reader, &size)) {
+        return false;
+    }
+    if (size == 0) {
+        return getCoeff(Reader, &(p->coeff)) && !(inner && p->coeff == 0);
+    }
+    // Every monomial takes at least two bytes.
+    if (size > (Reader->size - Reader->position) / 2) {
+        return false;
+    }
+
+    p->size = (size_t) size;
+    p->exps = (poly_exp_t *) PolyMalloc(PolyTermsBytes(p->size));
+    Poly *factors = PolyFactors(p);
+    for (size_t i = 0; i < p->size; ++i) {
+        p->exps[i] = 0;
+        factors[i] = PolyZero();
+    }
+    filePush(s, p);
+
+    return true;
+}
+
+/**
+ * The function checks the header of a file.
+ * @param[in,out] Reader : reader
+ * @param[in] magic : expected first four bytes of the file
+ * @return Is the header correct?
+ */
+static bool getHeader(reader *Reader, const char *magic) {
+    if (Reader->size < HEADER_SIZE || memcmp(Reader->bytes, magic, 4) != 0 ||
+        Reader->bytes[4] != FILE_VERSION || Reader->bytes[5] != sizeof(poly_coeff_t)) {
+        return false;
+    }
+    Reader->position = HEADER_SIZE;
+
+    return true;
+}
+
+/**
+ * The function builds a polynomial from the following bytes of a file.
+ * @param[in,out] Reader : reader
+ * @param[in,out] s : empty stack
+ * @param[out] p : polynomial, set only if it is correct
+ * @return Is the polynomial correct?
+ */
+static bool getTree(reader *Reader, fileStack *s, Poly *p) {
+    Poly r = PolyZero();
+    bool correct = getPoly(Reader, s, &r, false);
+
+    while (correct && s->size > 0) {
+        fileFrame *f = &(s->frames[s->size - 1]);
+        Poly *q = f->p;
+        if (f->next == q->size) {
+            // A single monomial with exponent 0 over a coefficient is a coefficient,
+            // with a positive exponent it is kept as a single term.
+            if (q->size == 1 && PolyIsCoeff(&(PolyFactors(q)[0]))) {
+                correct = q->exps[0] != 0;
+                Poly t = PolyTerm(PolyFactors(q)[0].coeff, q->exps[0]);
+                PolyFree(q->exps);
+                *q = t;
+            }
+            --s->size;
+        } else {
+            unsigned long long exp;
+            size_t i = f->next++;
+            correct = getVarint(Reader, &exp) && exp <= POLY_EXP_MAX &&
+                      (i == 0 || (poly_exp_t) exp > q->exps[i - 1]);
+            if (correct) {
+                q->exps[i] = (poly_exp_t) exp;
+                correct = getPoly(Reader, s, &(PolyFactors(q)[i]), true);
+            }
+        }
+    }
+
+    s->size = 0;
+    if (correct) {
+        *p = r;
+    } else {
+        PolyDestroy(&r);
+    }
+
+    return correct;
+}
+
+/**
+ * This is the result of reading a file.
+ */
+typedef struct {
+    bool many;      ///< does the file hold many polynomials?
+    size_t count;   ///< number of polynomials
+    Poly *polys;    ///< array of polynomials
+} contents;
+
+/**
+ * The function builds the polynomials from the bytes of a file.
+ * @param[in,out] Reader : reader
+ * @param[in,out] Contents : result, set only if the bytes are correct
+ * @return Are the bytes correct?
+ */
+static bool decode(reader *Reader, contents *Contents) {
+    unsigned long long count = 1;
+
+    if (!getHeader(Reader, Contents->many ? "PSTK" : "POLY") ||
+        (Contents->many && !getVarint(Reader, &count))) {
+        return false;
+    }
+    // Every polynomial takes at least a coefficient and its marker.
+    if (count > (Reader->size - Reader->position) / (1 + sizeof(poly_coeff_t))) {
+        return false;
+    }
+
+    fileStack s = {.frames = NULL, .size = 0, .capacity = 0};
+    Poly *polys = (Poly *) mallocSafe((count > 0 ? count : 1) * sizeof(Poly));
+    size_t done = 0;
+    while (done < count && getTree(Reader, &s, &(polys[done]))) {
+        ++done;
+    }
+    free(s.frames);
+
+    if (done < count || Reader->position != Reader->size) {
+        for (size_t i = 0; i < done; ++i) {
+            PolyDestroy(&(polys[i]));
+        }
+        free(polys);
+        return false;
+    }
+
+    Contents->count = (size_t) count;
+    Contents->polys = polys;
+
+    return true;
+}
+
+/**
+ * The function reads the polynomials from a file.
+ * Regular files are mapped into memory, other files are read into a buffer.
+ * @param[in] fd : file descriptor
+ * @param[in,out] Contents : result, set only if the file is correct
+ * @return Is the file correct?
+ */
+static bool readFile(int fd, contents *Contents) {
+    struct stat info;
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size == 0) {
+            return false;
+        }
+        void *map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, (size_t) info.st_size, POSIX_MADV_SEQUENTIAL);
+            reader Reader = {.bytes = (const unsigned char *) map,
+                             .size = (size_t) info.st_size, .position = 0};
+            bool correct = decode(&Reader, Contents);
+            munmap(map, (size_t) info.st_size);
+            return correct;
+        }
+    }
+
+    size_t size = 0;
+    size_t capacity = FILE_BUFFER;
+    unsigned char *bytes = (unsigned char *) mallocSafe(capacity);
+    ssize_t count;
+    do {
+        if (size == capacity) {
+            capacity *= 2;
+            bytes = (unsigned char *) realloc(bytes, capacity);
+            if (bytes == NULL) {
+                exit(1);
+            }
+        }
+        count = read(fd, bytes + size, capacity - size);
+        if (count > 0) {
+            size += (size_t) count;
+        }
+    } while (count > 0 || (count < 0 && errno == EINTR));
+
+    reader Reader = {.bytes = bytes, .size = size, .position = 0};
+    bool correct = count == 0 && decode(&Reader, Contents);
+    free(bytes);
+
+    return correct;
+}
+
+bool PolyReadFile(int fd, Poly *p) {
+    contents Contents = {.many = false};
+
+    if (!readFile(fd, &Contents)) {
+        return false;
+    }
+    *p = Contents.polys[0];
+    free(Contents.polys);
+
+    return true;
+}
+
+bool PolyReadStackFile(int fd, size_t *count, Poly **polys) {
+    contents Contents = {.many = true};
+
+    if (!readFile(fd, &Contents)) {
+        return false;
+    }
+    *count = Contents.count;
+    *polys = Contents.polys;
+
+    return true;
+}
@@ -0,0 +1,63 @@
+/** @file
+  Interface of the binary files of polynomials
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __POLYFILE_H__
+#define __POLYFILE_H__
+
+#include "poly.h"
+
+/**
+ * The function writes the polynomial to a binary file.
+ * The file starts with the header "POLY", the format version and the size
+ * of a coefficient in bytes. Then the polynomials follow in pre-order:
+ * a coefficient is written as 0 and the coefficient in fixed width,
+ * any other polynomial as the number of its monomials followed by
+ * the exponent and the coefficient of every monomial. Numbers of monomials
+ * and exponents are written as varints, all numbers are little-endian.
+ * @param[in] p : polynomial
+ * @param[in] fd : file descriptor
+ * @return Has the polynomial been written?
+ */
+bool PolyWriteFile(const Poly *p, int fd);
+
+/**
+ * The function reads the polynomial from a binary file written
+ * by PolyWriteFile. Regular files are mapped into memory and the polynomial
+ * is built in a single sequential pass. Files which do not hold
+ * a polynomial in the canonical form are rejected.
+ * @param[in] fd : file descriptor
+ * @param[out] p : polynomial, set only if the file is correct
+ * @return Is the file correct?
+ */
+bool PolyReadFile(int fd, Poly *p);
+
+/**
+ * The function writes the polynomials to a binary checkpoint file.
+ * The file starts with the header "PSTK", the format version and the size
+ * of a coefficient in bytes, followed by the number of polynomials as a varint
+ * and the polynomials in the order of the array, each written
+ * as by PolyWriteFile.
+ * @param[in] count : number of polynomials
+ * @param[in] polys : array of polynomials
+ * @param[in] fd : file descriptor
+ * @return Have the polynomials been written?
+ */
+bool PolyWriteStackFile(size_t count, const Poly polys[], int fd);
+
+/**
+ * The function reads the polynomials from a binary checkpoint file written
+ * by PolyWriteStackFile. Regular files are mapped into memory and read
+ * in a single sequential pass.
+ * @param[in] fd : file descriptor
+ * @param[out] count : number of polynomials, set only if the file is correct
+ * @param[out] polys : array of polynomials allocated on the heap,
+ * set only if the file is correct
+ * @return Is the file correct?
+ */
+bool PolyReadStackFile(int fd, size_t *count, Poly **polys);
+
+#endif /* __POLYFILE_H__ */
@@ -0,0 +1,438 @@
+/** @file
+  Implementation of the cache of the results of the operations on polynomials.
+  The results are kept in a hash table with chaining, the entries are also
+  linked in the order of use, so the least recently used one is dropped first.
+  The cached operands are copies, a hit is confirmed by comparing them
+  with the given ones, so a collision of hashes never gives a wrong result.
+  Every thread has a cache of its own, so the cache needs no locking.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "polyMemo.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * These are the cached operations.
+ */
+typedef enum {
+    MEMO_MUL,      ///< PolyMul
+    MEMO_AT,       ///< PolyAt
+    MEMO_EXP,      ///< PolyExp
+    MEMO_COMPOSE   ///< PolyCompose
+} memoOp;
+
+#if POLY_COEFF_BITS > 64
+/** This is the parameter of an operation, it holds any point. */
+typedef poly_coeff_t memoParameter;
+#else
+/** This is the parameter of an operation, it holds any point, power or number of polynomials. */
+typedef long memoParameter;
+#endif
+
+/**
+ * This is the cached result of an operation.
+ */
+typedef struct entry {
+    memoOp op;             ///< operation
+    memoParameter parameter; ///< point, power or number of the substituted polynomials
+    uint64_t hash;         ///< hash of the operation, the operands and the parameter
+    size_t count;          ///< number of operands
+    Poly *operands;        ///< copies of the operands
+    Poly result;           ///< copy of the result
+    size_t bytes;          ///< memory taken by the entry
+    struct entry *next;    ///< next entry in the same bucket
+    struct entry *newer;   ///< entry used later
+    struct entry *older;   ///< entry used earlier
+} entry;
+
+/** The buckets of the hash table. */
+static _Thread_local entry **buckets = NULL;
+
+/** The number of buckets, a power of two. */
+static _Thread_local size_t sizeofBuckets = 0;
+
+/** The number of entries. */
+static _Thread_local size_t entries = 0;
+
+/** The most recently used entry. */
+static _Thread_local entry *newest = NULL;
+
+/** The least recently used entry. */
+static _Thread_local entry *oldest = NULL;
+
+/** The memory limit in bytes, 0 if the cache is off. */
+static _Thread_local size_t maxBytes = 0;
+
+/** The memory taken by the entries. */
+static _Thread_local size_t usedBytes = 0;
+
+/** The number of operations found in the cache. */
+static _Thread_local size_t hitCount = 0;
+
+/** The number of operations performed. */
+static _Thread_local size_t missCount = 0;
+
+/**
+ * The function mixes the value into the hash.
+ * @param[in] h : hash
+ * @param[in] v : value
+ * @return hash
+ */
+static inline uint64_t mix(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+/**
+ * This is the list of monomials still to be visited by polyHash.
+ */
+typedef struct {
+    Mono *monos;         ///< array of monomials
+    size_t size;         ///< number of monomials
+    size_t capacity;     ///< size of the array
+} monoStack;
+
+/**
+ * The function puts the monomials of the polynomial on the list,
+ * the first monomial on the top.
+ * @param[in,out] s : list of monomials
+ * @param[in] p : polynomial which is not a coefficient
+ */
+static void pushMonos(monoStack *s, const Poly *p) {
+    for (size_t i = PolyLength(p); i-- > 0;) {
+        if (s->size == s->capacity) {
+            s->capacity = 2 * s->capacity + 16;
+            s->monos = (Mono *) PolyRealloc(s->monos, s->capacity * sizeof(Mono));
+        }
+        s->monos[s->size++] = PolyGetMono(p, i);
+    }
+}
+
+/**
+ * The function computes the structural hash of the polynomial
+ * and counts its monomials, without recursion.
+ * @param[in] p : polynomial
+ * @param[out] monos : number of monomials
+ * @return hash
+ */
+static uint64_t polyHash(const Poly *p, size_t *monos) {
+    *monos = 0;
+    if (PolyIsCoeff(p)) {
+        return mix(0, (uint64_t) p->coeff);
+    }
+
+    monoStack s = {.monos = NULL, .size = 0, .capacity = 0};
+    uint64_t h = mix(0, ~(uint64_t) PolyLength(p));
+    pushMonos(&s, p);
+
+    while (s.size > 0) {
+        Mono m = s.monos[--s.size];
+        ++*monos;
+        h = mix(h, (uint64_t) m.exp);
+        if (PolyIsCoeff(&(m.p))) {
+            h = mix(h, (uint64_t) m.p.coeff);
+        } else {
+            h = mix(h, ~(uint64_t) PolyLength(&(m.p)));
+            pushMonos(&s, &(m.p));
+        }
+    }
+
+    PolyFree(s.monos);
+
+    return h;
+}
+
+/**
+ * The function removes the entry from the list of use.
+ * @param[in,out] e : entry
+ */
+static void detach(entry *e) {
+    if (e->newer != NULL) {
+        e->newer->older = e->older;
+    } else {
+        newest = e->older;
+    }
+    if (e->older != NULL) {
+        e->older->newer = e->newer;
+    } else {
+        oldest = e->newer;
+    }
+}
+
+/**
+ * The function puts the entry at the front of the list of use.
+ * @param[in,out] e : entry
+ */
+static void linkNewest(entry *e) {
+    e->older = newest;
+    e->newer = NULL;
+    if (newest != NULL) {
+        newest->newer = e;
+    } else {
+        oldest = e;
+    }
+    newest = e;
+}
+
+/**
+ * The function removes the entry from the cache and from memory.
+ * @param[in] e : entry
+ */
+static void dropEntry(entry *e) {
+    entry **link = &(buckets[e->hash & (sizeofBuckets - 1)]);
+    while (*link != e) {
+        link = &((*link)->next);
+    }
+    *link = e->next;
+    detach(e);
+
+    for (size_t i = 0; i < e->count; ++i) {
+        PolyDestroy(&(e->operands[i]));
+    }
+    PolyFree(e->operands);
+    PolyDestroy(&(e->result));
+    usedBytes -= e->bytes;
+    --entries;
+    PolyFree(e);
+}
+
+/**
+ * The function doubles the number of buckets.
+ */
+static void growBuckets(void) {
+    size_t size = sizeofBuckets == 0 ? 256 : 2 * sizeofBuckets;
+    entry **table = (entry **) PolyMalloc(size * sizeof(entry *));
+    memset(table, 0, size * sizeof(entry *));
+
+    for (size_t i = 0; i < sizeofBuckets; ++i) {
+        entry *e = buckets[i];
+        while (e != NULL) {
+            entry *next = e->next;
+            e->next = table[e->hash & (size - 1)];
+            table[e->hash & (size - 1)] = e;
+            e = next;
+        }
+    }
+
+    PolyFree(buckets);
+    buckets = table;
+    sizeofBuckets = size;
+}
+
+/**
+ * The function looks for the result of the operation in the cache.
+ * @param[in] op : operation
+ * @param[in] parameter : parameter
+ * @param[in] hash : hash of the operation
+ * @param[in] count : number of operands
+ * @param[in] operands : operands, for MEMO_MUL in any order
+ * @return entry, NULL if there is none
+ */
+static entry *find(memoOp op, memoParameter parameter, uint64_t hash,
+                   size_t count, const Poly *operands[]) {
+    if (sizeofBuckets == 0) {
+        return NULL;
+    }
+
+    for (entry *e = buckets[hash & (sizeofBuckets - 1)]; e != NULL; e = e->next) {
+        if (e->hash == hash && e->op == op && e->parameter == parameter && e->count == count) {
+            size_t i = 0;
+            while (i < count && PolyIsEq(&(e->operands[i]), operands[i])) {
+                ++i;
+            }
+            if (i == count || (op == MEMO_MUL && PolyIsEq(&(e->operands[0]), operands[1]) &&
+                               PolyIsEq(&(e->operands[1]), operands[0]))) {
+                return e;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * The function puts the result of the operation into the cache,
+ * dropping the least recently used entries above the memory limit.
+ * @param[in] op : operation
+ * @param[in] parameter : parameter
+ * @param[in] hash : hash of the operation
+ * @param[in] count : number of operands
+ * @param[in] operands : operands
+ * @param[in] monos : number of monomials of the operands
+ * @param[in] result : result
+ */
+static void insert(memoOp op, memoParameter parameter, uint64_t hash, size_t count,
+                   const Poly *operands[], size_t monos, const Poly *result) {
+    size_t resultMonos;
+    polyHash(result, &resultMonos);
+    size_t size = sizeof(entry) + count * sizeof(Poly) +
+                  (monos + resultMonos) * (sizeof(poly_exp_t) + sizeof(Poly));
+    if (size > maxBytes) {
+        return;
+    }
+
+    while (usedBytes + size > maxBytes) {
+        dropEntry(oldest);
+    }
+    if (entries >= sizeofBuckets) {
+        growBuckets();
+    }
+
+    entry *e = (entry *) PolyMalloc(sizeof(entry));
+    e->op = op;
+    e->parameter = parameter;
+    e->hash = hash;
+    e->count = count;
+    e->operands = (Poly *) PolyMalloc(count * sizeof(Poly));
+    for (size_t i = 0; i < count; ++i) {
+        e->operands[i] = PolyClone(operands[i]);
+    }
+    e->result = PolyClone(result);
+    e->bytes = size;
+
+    e->next = buckets[hash & (sizeofBuckets - 1)];
+    buckets[hash & (sizeofBuckets - 1)] = e;
+    linkNewest(e);
+    usedBytes += size;
+    ++entries;
+}
+
+/**
+ * The function performs the operation on the operands.
+ * @param[in] op : operation
+ * @param[in] parameter : parameter
+ * @param[in] operands : operands
+ * @param[in] q : substituted polynomials, for MEMO_COMPOSE
+ * @return result
+ */
+static Poly perform(memoOp op, memoParameter parameter, const Poly *operands[], const Poly q[]) {
+    switch (op) {
+        case MEMO_MUL:
+            return PolyMul(operands[0], operands[1]);
+        case MEMO_AT:
+            return PolyAt(operands[0], (poly_coeff_t) parameter);
+        case MEMO_EXP:
+            return PolyExp(operands[0], (poly_exp_t) parameter);
+        default:
+            return PolyCompose(operands[0], (size_t) parameter, q);
+    }
+}
+
+/**
+ * The function returns the result of the operation, from the cache if it is
+ * there, otherwise it performs the operation and puts the result into the cache.
+ * Operations on coefficients only are not cached.
+ * @param[in] op : operation
+ * @param[in] parameter : parameter
+ * @param[in] count : number of operands
+ * @param[in] operands : operands
+ * @param[in] q : substituted polynomials, for MEMO_COMPOSE
+ * @return result
+ */
+static Poly memo(memoOp op, memoParameter parameter, size_t count, const Poly *operands[], const Poly q[]) {
+    if (maxBytes == 0) {
+        return perform(op, parameter, operands, q);
+    }
+
+    uint64_t hash = mix(mix(0, (uint64_t) op), (uint64_t) parameter);
+#if POLY_COEFF_BITS > 64
+    hash = mix(hash, (uint64_t) (parameter >> 64));
+#endif
+    uint64_t factors = 0;
+    size_t monos = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t n;
+        uint64_t h = polyHash(operands[i], &n);
+        monos += n;
+        // The product does not depend on the order of the factors.
+        if (op == MEMO_MUL) {
+            factors += h;
+        } else {
+            hash = mix(hash, h);
+        }
+    }
+    if (monos == 0) {
+        return perform(op, parameter, operands, q);
+    }
+    if (op == MEMO_MUL) {
+        hash = mix(hash, factors);
+    }
+
+    entry *e = find(op, parameter, hash, count, operands);
+    if (e != NULL) {
+        ++hitCount;
+        detach(e);
+        linkNewest(e);
+        return PolyClone(&(e->result));
+    }
+
+    ++missCount;
+    Poly r = perform(op, parameter, operands, q);
+    insert(op, parameter, hash, count, operands, monos, &r);
+
+    return r;
+}
+
+void PolyMemoStart(size_t limit) {
+    PolyMemoStop();
+    maxBytes = limit;
+    hitCount = 0;
+    missCount = 0;
+}
+
+void PolyMemoClear(void) {
+    while (oldest != NULL) {
+        dropEntry(oldest);
+    }
+    PolyFree(buckets);
+    buckets = NULL;
+    sizeofBuckets = 0;
+}
+
+void PolyMemoStop(void) {
+    PolyMemoClear();
+    maxBytes = 0;
+}
+
+bool PolyMemoIsOn(void) {
+    return maxBytes > 0;
+}
+
+Poly PolyMemoMul(const Poly *p, const Poly *q) {
+    const Poly *operands[2] = {p, q};
+
+    return memo(MEMO_MUL, 0, 2, operands, NULL);
+}
+
+Poly PolyMemoAt(const Poly *p, poly_coeff_t x) {
+    const Poly *operands[1] = {p};
+
+    return memo(MEMO_AT, x, 1, operands, NULL);
+}
+
+Poly PolyMemoExp(const Poly *p, poly_exp_t exp) {
+    const Poly *operands[1] = {p};
+
+    return memo(MEMO_EXP, exp, 1, operands, NULL);
+}
+
+Poly PolyMemoCompose(const Poly *p, size_t k, const Poly q[]) {
+    const Poly **operands = (const Poly **) PolyMalloc((k + 1) * sizeof(Poly *));
+    operands[0] = p;
+    for (size_t i = 0; i < k; ++i) {
+        operands[i + 1] = &(q[i]);
+    }
+
+    Poly r = memo(MEMO_COMPOSE, (memoParameter) k, k + 1, operands, q);
+    PolyFree(operands);
+
+    return r;
+}
+
+void PolyMemoCounters(size_t *hits, size_t *misses) {
+    *hits = hitCount;
+    *misses = missCount;
+}
@@ -0,0 +1,86 @@
+/** @file
+  Interface of the cache of the results of the operations on polynomials
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __POLYMEMO_H__
+#define __POLYMEMO_H__
+
+#include "poly.h"
+
+/**
+ * The function turns the cache on. The results of PolyMul, PolyAt, PolyExp
+ * and PolyCompose performed by the functions below are kept in the cache,
+ * keyed by the operation, the operands and the parameter. When the memory
+ * taken by the cached operands and results exceeds @p limit bytes,
+ * the least recently used results are dropped. If the cache is off,
+ * the functions below only perform the operations. The cache belongs
+ * to the calling thread, other threads have their own caches.
+ * @param[in] limit : memory limit in bytes, 0 turns the cache off
+ */
+void PolyMemoStart(size_t limit);
+
+/**
+ * The function removes all the results from the cache and turns it off.
+ */
+void PolyMemoStop(void);
+
+/**
+ * The function removes all the results from the cache, which stays on.
+ */
+void PolyMemoClear(void);
+
+/**
+ * The function checks whether the cache of the calling thread is on.
+ * @return Is the cache on?
+ */
+bool PolyMemoIsOn(void);
+
+/**
+ * The function multiplies two polynomials, see PolyMul,
+ * using the cached result if there is one.
+ * @param[in] p : polynomial @f$p@f$
+ * @param[in] q : polynomial @f$q@f$
+ * @return @f$p * q@f$
+ */
+Poly PolyMemoMul(const Poly *p, const Poly *q);
+
+/**
+ * The function computes the value of the polynomial at the point, see PolyAt,
+ * using the cached result if there is one.
+ * @param[in] p : polynomial @f$p@f$
+ * @param[in] x : point @f$x@f$
+ * @return @f$p(x, x_0, x_1, \ldots)@f$
+ */
+Poly PolyMemoAt(const Poly *p, poly_coeff_t x);
+
+/**
+ * The function exponentiates the polynomial, see PolyExp,
+ * using the cached result if there is one.
+ * @param[in] p : polynomial
+ * @param[in] exp : power
+ * @return polynomial
+ */
+Poly PolyMemoExp(const Poly *p, poly_exp_t exp);
+
+/**
+ * The function composes the polynomials, see PolyCompose,
+ * using the cached result if there is one.
+ * @param[in] p : polynomial
+ * @param[in] k : array size
+ * @param[in] q : array of polynomials
+ * @return the resulting polynomial
+ */
+Poly PolyMemoCompose(const Poly *p, size_t k, const Poly q[]);
+
+/**
+ * The function gives the numbers of the operations found in the cache
+ * and the ones performed, since the cache was turned on.
+ * @param[out] hits : number of operations found in the cache
+ * @param[out] misses : number of operations performed
+ */
+void PolyMemoCounters(size_t *hits, size_t *misses);
+
+#endif /* __POLYMEMO_H__ */
@@ -0,0 +1,99 @@
+/** @file
+  Test of the counters of the cache in the modes of the calculator. Every
+  script is run by the calculator with the cache on, without options, with
+  "--lazy" and with "--compile", and the three outputs, with the lines
+  printed by MEMO, must be the same. The path of the calculator is the
+  argument of the test, "./poly" by default.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** The size of the buffer of the output of one run. */
+#define MEMO_TEST_OUTPUT 4096
+
+/** The scripts run by the test. */
+static const char *const scripts[] = {
+    "(1,1)\n(2,2)\nMUL\nMUL\nMEMO\n",
+    "(1,1)\n(2,2)\nMUL\n(1,1)\n(2,2)\nMUL\nMEMO\n",
+    "((1,1)+(2,0),1)\nCLONE\nMUL\nCLONE\nAT 2\nMEMO\nPOP\nCLONE\nMUL\nCOMPOSE 0\nMEMO\n",
+    "((1,1)+(2,0),1)\n(3,1)\nMUL\n(3,1)\n((1,1)+(2,0),1)\nMUL\nADD\nAT -1\nMEMO\n",
+};
+
+/** The options of the modes compared by the test. */
+static const char *const modes[] = {"", "--lazy", "--compile"};
+
+/**
+ * The function runs the calculator on the script and reads its output.
+ * @param[in] poly : path of the calculator
+ * @param[in] mode : option of the mode
+ * @param[in] script : path of the script
+ * @param[out] output : buffer of the output
+ * @return whether the run succeeded
+ */
+static int run(const char *poly, const char *mode, const char *script,
+               char output[MEMO_TEST_OUTPUT]) {
+    char command[1024];
+    snprintf(command, sizeof(command), "'%s' --memo 100000 %s < '%s' 2>&1", poly, mode, script);
+
+    FILE *pipe = popen(command, "r");
+    if (pipe == NULL) {
+        return 0;
+    }
+    size_t length = fread(output, 1, MEMO_TEST_OUTPUT - 1, pipe);
+    output[length] = '\0';
+
+    return pclose(pipe) == 0;
+}
+
+/**
+ * The function runs every script in every mode and compares the outputs.
+ * @param[in] argc : number of arguments
+ * @param[in] argv : arguments
+ * @return 0 if the test passes, 1 otherwise
+ */
+int main(int argc, char *argv[]) {
+    const char *poly = argc > 1 ? argv[1] : "./poly";
+    char script[] = "/tmp/poly_memo_testXXXXXX";
+    int fd = mkstemp(script);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+
+    int errors = 0;
+    size_t count = sizeof(scripts) / sizeof(scripts[0]);
+    for (size_t i = 0; i < count; ++i) {
+        FILE *file = fopen(script, "w");
+        if (file == NULL || fputs(scripts[i], file) == EOF || fclose(file) != 0) {
+            remove(script);
+            return 1;
+        }
+
+        char expected[MEMO_TEST_OUTPUT];
+        if (!run(poly, modes[0], script, expected)) {
+            fprintf(stderr, "script %zu: the calculator failed\n", i);
+            ++errors;
+            continue;
+        }
+        for (size_t j = 1; j < sizeof(modes) / sizeof(modes[0]); ++j) {
+            char output[MEMO_TEST_OUTPUT];
+            if (!run(poly, modes[j], script, output) || strcmp(output, expected) != 0) {
+                fprintf(stderr, "script %zu, %s: output differs\n", i, modes[j]);
+                ++errors;
+            }
+        }
+    }
+    remove(script);
+
+    fprintf(stderr, "%zu scripts, %d errors\n", count, errors);
+
+    return errors == 0 ? 0 : 1;
+}
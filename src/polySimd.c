@@ -0,0 +1,430 @@
+/** @file
+  Implementation of the vector kernels of the innermost level of the polynomials.
+  A coefficient is a polynomial whose pointer to the exponents is NULL, so
+  an array of coefficients is an array of 64-bit lanes: a coefficient, a zero,
+  a coefficient, a zero and so on. The kernels work on whole vectors of these
+  lanes, a subtraction from zero, a sum or a product by a scalar keeps the zero
+  lanes zero. The widest kernels supported by the processor are chosen
+  when the program starts, the narrower ones finish the remaining coefficients.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "polySimd.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+/** The vector kernels are compiled. */
+#define SIMD_X86 1
+#endif
+
+/**
+ * Can an array of coefficients be seen as an array of 64-bit lanes?
+ * It depends on the types of poly.h, with other types only the scalar
+ * kernels are used.
+ */
+#define LANES (sizeof(poly_coeff_t) == sizeof(int64_t) && \
+               sizeof(Poly) == 2 * sizeof(int64_t) && \
+               offsetof(Poly, exps) == sizeof(int64_t))
+
+/**
+ * This is a set of kernels, see polySimd.h.
+ */
+typedef struct {
+    bool (*allCoeffs)(size_t count, const Poly p[]);                       ///< PolySimdAllCoeffs
+    void (*neg)(size_t count, const Poly p[], Poly r[]);                   ///< PolySimdNeg
+    void (*scale)(size_t count, const Poly p[], poly_coeff_t c, Poly r[]); ///< PolySimdScale
+    void (*add)(size_t count, const Poly p[], const Poly q[], Poly r[]);   ///< PolySimdAdd
+    bool (*isEq)(size_t count, const Poly p[], const Poly q[]);            ///< PolySimdIsEq
+} kernels;
+
+/** @name Scalar kernels
+ * They work with any types of poly.h.
+ */
+///@{
+
+/** @see PolySimdAllCoeffs */
+static bool allCoeffsScalar(size_t count, const Poly p[]) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!PolyIsCoeff(&(p[i]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** @see PolySimdNeg */
+static void negScalar(size_t count, const Poly p[], Poly r[]) {
+    for (size_t i = 0; i < count; ++i) {
+        r[i] = PolyFromCoeff(-p[i].coeff);
+    }
+}
+
+/** @see PolySimdScale */
+static void scaleScalar(size_t count, const Poly p[], poly_coeff_t c, Poly r[]) {
+    for (size_t i = 0; i < count; ++i) {
+        r[i] = PolyFromCoeff(p[i].coeff * c);
+    }
+}
+
+/** @see PolySimdAdd */
+static void addScalar(size_t count, const Poly p[], const Poly q[], Poly r[]) {
+    for (size_t i = 0; i < count; ++i) {
+        r[i] = PolyFromCoeff(p[i].coeff + q[i].coeff);
+    }
+}
+
+/** @see PolySimdIsEq */
+static bool isEqScalar(size_t count, const Poly p[], const Poly q[]) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!PolyIsCoeff(&(q[i])) || p[i].coeff != q[i].coeff) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///@}
+
+/** These are the kernels in use. */
+static kernels Kernels = {
+    .allCoeffs = allCoeffsScalar,
+    .neg = negScalar,
+    .scale = scaleScalar,
+    .add = addScalar,
+    .isEq = isEqScalar
+};
+
+#ifdef SIMD_X86
+
+/** The function is compiled into each kernel calling it. */
+#define INLINE static inline __attribute__((always_inline))
+
+/** @name SSE2 kernels
+ * One coefficient in a vector, SSE2 is a part of every x86-64 processor.
+ * The wider kernels finish with them, so they are inlined and compiled
+ * for the instruction set of the caller: a jump from AVX code to the old
+ * SSE encoding without clearing the upper halves of the registers makes
+ * every SSE instruction after it slow.
+ */
+///@{
+
+/**
+ * The function gives the lower 64 bits of the products of the lanes.
+ * @param[in] a : lanes
+ * @param[in] b : lanes
+ * @return products
+ */
+INLINE __m128i mul128(__m128i a, __m128i b) {
+    __m128i low = _mm_mul_epu32(a, b);
+    __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b),
+                                  _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+
+    return _mm_add_epi64(low, _mm_slli_epi64(cross, 32));
+}
+
+/** @see PolySimdAllCoeffs */
+INLINE bool allCoeffsSse2(size_t count, const Poly p[]) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128i pointers = _mm_unpackhi_epi64(_mm_loadu_si128((const __m128i *) &(p[i])),
+                                              _mm_loadu_si128((const __m128i *) &(p[i + 1])));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(pointers, zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+
+    return i == count || PolyIsCoeff(&(p[i]));
+}
+
+/** @see PolySimdNeg */
+INLINE void negSse2(size_t count, const Poly p[], Poly r[]) {
+    const __m128i zero = _mm_setzero_si128();
+
+    for (size_t i = 0; i < count; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &(p[i]));
+        _mm_storeu_si128((__m128i *) &(r[i]), _mm_sub_epi64(zero, v));
+    }
+}
+
+/** @see PolySimdScale */
+INLINE void scaleSse2(size_t count, const Poly p[], poly_coeff_t c, Poly r[]) {
+    const __m128i scalar = _mm_set1_epi64x((long long) c);
+
+    for (size_t i = 0; i < count; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &(p[i]));
+        _mm_storeu_si128((__m128i *) &(r[i]), mul128(v, scalar));
+    }
+}
+
+/** @see PolySimdAdd */
+INLINE void addSse2(size_t count, const Poly p[], const Poly q[], Poly r[]) {
+    for (size_t i = 0; i < count; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &(p[i]));
+        __m128i w = _mm_loadu_si128((const __m128i *) &(q[i]));
+        _mm_storeu_si128((__m128i *) &(r[i]), _mm_add_epi64(v, w));
+    }
+}
+
+/** @see PolySimdIsEq */
+INLINE bool isEqSse2(size_t count, const Poly p[], const Poly q[]) {
+    for (size_t i = 0; i < count; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &(p[i]));
+        __m128i w = _mm_loadu_si128((const __m128i *) &(q[i]));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, w)) != 0xFFFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///@}
+
+/** These are the SSE2 kernels. */
+static const kernels Sse2 = {
+    .allCoeffs = allCoeffsSse2,
+    .neg = negSse2,
+    .scale = scaleSse2,
+    .add = addSse2,
+    .isEq = isEqSse2
+};
+
+/** @name AVX2 kernels
+ * Two coefficients in a vector.
+ */
+///@{
+
+/**
+ * The function gives the lower 64 bits of the products of the lanes.
+ * @param[in] a : lanes
+ * @param[in] b : lanes
+ * @return products
+ */
+__attribute__((target("avx2")))
+static inline __m256i mul256(__m256i a, __m256i b) {
+    __m256i low = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+/** @see PolySimdAllCoeffs */
+__attribute__((target("avx2")))
+static bool allCoeffsAvx2(size_t count, const Poly p[]) {
+    const __m256i pointers = _mm256_set_epi64x(-1, 0, -1, 0);
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &(p[i]));
+        if (!_mm256_testz_si256(v, pointers)) {
+            return false;
+        }
+    }
+
+    return allCoeffsSse2(count - i, p + i);
+}
+
+/** @see PolySimdNeg */
+__attribute__((target("avx2")))
+static void negAvx2(size_t count, const Poly p[], Poly r[]) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &(p[i]));
+        _mm256_storeu_si256((__m256i *) &(r[i]), _mm256_sub_epi64(zero, v));
+    }
+    negSse2(count - i, p + i, r + i);
+}
+
+/** @see PolySimdScale */
+__attribute__((target("avx2")))
+static void scaleAvx2(size_t count, const Poly p[], poly_coeff_t c, Poly r[]) {
+    const __m256i scalar = _mm256_set1_epi64x((long long) c);
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &(p[i]));
+        _mm256_storeu_si256((__m256i *) &(r[i]), mul256(v, scalar));
+    }
+    scaleSse2(count - i, p + i, c, r + i);
+}
+
+/** @see PolySimdAdd */
+__attribute__((target("avx2")))
+static void addAvx2(size_t count, const Poly p[], const Poly q[], Poly r[]) {
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &(p[i]));
+        __m256i w = _mm256_loadu_si256((const __m256i *) &(q[i]));
+        _mm256_storeu_si256((__m256i *) &(r[i]), _mm256_add_epi64(v, w));
+    }
+    addSse2(count - i, p + i, q + i, r + i);
+}
+
+/** @see PolySimdIsEq */
+__attribute__((target("avx2")))
+static bool isEqAvx2(size_t count, const Poly p[], const Poly q[]) {
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) &(p[i]));
+        __m256i w = _mm256_loadu_si256((const __m256i *) &(q[i]));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(v, w)) != -1) {
+            return false;
+        }
+    }
+
+    return isEqSse2(count - i, p + i, q + i);
+}
+
+///@}
+
+/** These are the AVX2 kernels. */
+static const kernels Avx2 = {
+    .allCoeffs = allCoeffsAvx2,
+    .neg = negAvx2,
+    .scale = scaleAvx2,
+    .add = addAvx2,
+    .isEq = isEqAvx2
+};
+
+/** @name AVX-512 kernels
+ * Four coefficients in a vector, the products need AVX-512DQ.
+ */
+///@{
+
+/** The mask of the lanes of the pointers in an AVX-512 vector. */
+#define POINTER_LANES 0xAA
+
+/** @see PolySimdAllCoeffs */
+__attribute__((target("avx512f,avx512dq")))
+static bool allCoeffsAvx512(size_t count, const Poly p[]) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m512i v = _mm512_loadu_si512((const void *) &(p[i]));
+        if (_mm512_mask_test_epi64_mask(POINTER_LANES, v, v) != 0) {
+            return false;
+        }
+    }
+
+    return allCoeffsAvx2(count - i, p + i);
+}
+
+/** @see PolySimdNeg */
+__attribute__((target("avx512f,avx512dq")))
+static void negAvx512(size_t count, const Poly p[], Poly r[]) {
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m512i v = _mm512_loadu_si512((const void *) &(p[i]));
+        _mm512_storeu_si512((void *) &(r[i]), _mm512_sub_epi64(zero, v));
+    }
+    negAvx2(count - i, p + i, r + i);
+}
+
+/** @see PolySimdScale */
+__attribute__((target("avx512f,avx512dq")))
+static void scaleAvx512(size_t count, const Poly p[], poly_coeff_t c, Poly r[]) {
+    const __m512i scalar = _mm512_set1_epi64((long long) c);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m512i v = _mm512_loadu_si512((const void *) &(p[i]));
+        _mm512_storeu_si512((void *) &(r[i]), _mm512_mullo_epi64(v, scalar));
+    }
+    scaleAvx2(count - i, p + i, c, r + i);
+}
+
+/** @see PolySimdAdd */
+__attribute__((target("avx512f,avx512dq")))
+static void addAvx512(size_t count, const Poly p[], const Poly q[], Poly r[]) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m512i v = _mm512_loadu_si512((const void *) &(p[i]));
+        __m512i w = _mm512_loadu_si512((const void *) &(q[i]));
+        _mm512_storeu_si512((void *) &(r[i]), _mm512_add_epi64(v, w));
+    }
+    addAvx2(count - i, p + i, q + i, r + i);
+}
+
+/** @see PolySimdIsEq */
+__attribute__((target("avx512f,avx512dq")))
+static bool isEqAvx512(size_t count, const Poly p[], const Poly q[]) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m512i v = _mm512_loadu_si512((const void *) &(p[i]));
+        __m512i w = _mm512_loadu_si512((const void *) &(q[i]));
+        if (_mm512_cmpneq_epi64_mask(v, w) != 0) {
+            return false;
+        }
+    }
+
+    return isEqAvx2(count - i, p + i, q + i);
+}
+
+///@}
+
+/** These are the AVX-512 kernels. */
+static const kernels Avx512 = {
+    .allCoeffs = allCoeffsAvx512,
+    .neg = negAvx512,
+    .scale = scaleAvx512,
+    .add = addAvx512,
+    .isEq = isEqAvx512
+};
+
+/**
+ * The function chooses the kernels for the processor before the program
+ * starts, so the threads only read them.
+ */
+__attribute__((constructor))
+static void chooseKernels(void) {
+    if (!LANES) {
+        return;
+    }
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+        Kernels = Avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        Kernels = Avx2;
+    } else {
+        Kernels = Sse2;
+    }
+}
+
+#endif /* SIMD_X86 */
+
+bool PolySimdAllCoeffs(size_t count, const Poly p[]) {
+    return Kernels.allCoeffs(count, p);
+}
+
+void PolySimdNeg(size_t count, const Poly p[], Poly r[]) {
+    Kernels.neg(count, p, r);
+}
+
+void PolySimdScale(size_t count, const Poly p[], poly_coeff_t c, Poly r[]) {
+    Kernels.scale(count, p, c, r);
+}
+
+void PolySimdAdd(size_t count, const Poly p[], const Poly q[], Poly r[]) {
+    Kernels.add(count, p, q, r);
+}
+
+bool PolySimdIsEq(size_t count, const Poly p[], const Poly q[]) {
+    return Kernels.isEq(count, p, q);
+}
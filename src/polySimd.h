@@ -0,0 +1,57 @@
+/** @file
+  Interface of the vector kernels of the innermost level of the polynomials,
+  where all the factors of the monomials are coefficients
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __POLYSIMD_H__
+#define __POLYSIMD_H__
+
+#include "poly.h"
+
+/**
+ * The function checks if all the polynomials are coefficients.
+ * @param[in] count : number of polynomials
+ * @param[in] p : polynomials
+ * @return Are they all coefficients?
+ */
+bool PolySimdAllCoeffs(size_t count, const Poly p[]);
+
+/**
+ * The function negates the coefficients.
+ * @param[in] count : number of coefficients
+ * @param[in] p : coefficients
+ * @param[out] r : @f$-p_i@f$
+ */
+void PolySimdNeg(size_t count, const Poly p[], Poly r[]);
+
+/**
+ * The function multiplies the coefficients by a scalar.
+ * @param[in] count : number of coefficients
+ * @param[in] p : coefficients
+ * @param[in] c : scalar
+ * @param[out] r : @f$p_i * c@f$
+ */
+void PolySimdScale(size_t count, const Poly p[], poly_coeff_t c, Poly r[]);
+
+/**
+ * The function adds the coefficients in pairs.
+ * @param[in] count : number of coefficients
+ * @param[in] p : coefficients
+ * @param[in] q : coefficients
+ * @param[out] r : @f$p_i + q_i@f$
+ */
+void PolySimdAdd(size_t count, const Poly p[], const Poly q[], Poly r[]);
+
+/**
+ * The function compares the coefficients with the polynomials in pairs.
+ * @param[in] count : number of coefficients
+ * @param[in] p : coefficients
+ * @param[in] q : polynomials
+ * @return Is every @f$q_i@f$ the coefficient @f$p_i@f$?
+ */
+bool PolySimdIsEq(size_t count, const Poly p[], const Poly q[]);
+
+#endif /* __POLYSIMD_H__ */
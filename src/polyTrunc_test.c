@@ -0,0 +1,135 @@
+/** @file
+  Test of the truncated multiplication and exponentiation. For random
+  polynomials, PolyMulTrunc and PolyExpTrunc must give the full product
+  and power computed by PolyMul and PolyExp with the monomials of total
+  degree greater than the bound left out.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "poly.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/** The number of random pairs of polynomials. */
+#define TRUNC_TEST_PAIRS 300
+
+/** The largest degree bound which is checked. */
+#define TRUNC_TEST_DEG 14
+
+/** The largest exponent of PolyExpTrunc which is checked. */
+#define TRUNC_TEST_EXP 4
+
+/**
+ * The function gives a random polynomial with small coefficients and
+ * exponents, with constants, single terms and nested factors among them.
+ * @param[in] depth : how many more levels the factors may nest
+ * @return polynomial
+ */
+static Poly randomPoly(int depth) {
+    if (depth == 0 || rand() % 4 == 0) {
+        return PolyFromCoeff(rand() % 7 - 3);
+    }
+
+    size_t count = 0;
+    Mono monos[3];
+    for (int i = rand() % 3; i >= 0; --i) {
+        Poly factor = randomPoly(depth - 1);
+        if (!PolyIsZero(&factor)) {
+            monos[count++] = MonoFromPoly(&factor, rand() % 5);
+        }
+    }
+
+    return PolyAddMonos(count, monos);
+}
+
+/**
+ * The function leaves out the monomials of total degree greater than the
+ * bound, without using the truncated operations.
+ * @param[in] p : polynomial
+ * @param[in] deg : degree bound
+ * @return polynomial
+ */
+static Poly truncate(const Poly *p, long long deg) {
+    if (PolyIsCoeff(p)) {
+        return PolyClone(p);
+    }
+
+    size_t count = 0;
+    Mono *monos = (Mono *) malloc(PolyLength(p) * sizeof(Mono));
+    if (monos == NULL) {
+        exit(1);
+    }
+    for (size_t i = 0; i < PolyLength(p); ++i) {
+        Mono m = PolyGetMono(p, i);
+        if (m.exp <= deg) {
+            Poly factor = truncate(&(m.p), deg - m.exp);
+            if (!PolyIsZero(&factor)) {
+                monos[count++] = MonoFromPoly(&factor, m.exp);
+            }
+        }
+    }
+    Poly r = PolyAddMonos(count, monos);
+    free(monos);
+
+    return r;
+}
+
+/**
+ * The function compares the result of a truncated operation with the
+ * truncated full result and reports a difference.
+ * @param[in] name : name of the operation
+ * @param[in] pair : number of the pair of polynomials
+ * @param[in] deg : degree bound
+ * @param[in] result : result of the truncated operation
+ * @param[in] full : full result
+ * @return 1 if they differ, 0 otherwise
+ */
+static int check(const char *name, int pair, int deg, Poly *result, Poly *full) {
+    Poly expected = truncate(full, deg);
+    int error = !PolyIsEq(result, &expected);
+    if (error) {
+        fprintf(stderr, "%s, pair %d, degree %d: wrong result\n", name, pair, deg);
+    }
+    PolyDestroy(&expected);
+    PolyDestroy(result);
+
+    return error;
+}
+
+/**
+ * The function checks the truncated operations on random polynomials.
+ * @return 0 if the test passes, 1 otherwise
+ */
+int main(void) {
+    int errors = 0;
+
+    srand(1);
+    for (int pair = 0; pair < TRUNC_TEST_PAIRS; ++pair) {
+        Poly p = randomPoly(3);
+        Poly q = randomPoly(3);
+        Poly product = PolyMul(&p, &q);
+
+        for (int deg = 0; deg <= TRUNC_TEST_DEG; ++deg) {
+            Poly result = PolyMulTrunc(&p, &q, deg);
+            errors += check("PolyMulTrunc", pair, deg, &result, &product);
+        }
+        for (int exp = 0; exp <= TRUNC_TEST_EXP; ++exp) {
+            Poly power = PolyExp(&p, exp);
+            for (int deg = 0; deg <= TRUNC_TEST_DEG; ++deg) {
+                Poly result = PolyExpTrunc(&p, exp, deg);
+                errors += check("PolyExpTrunc", pair, deg, &result, &power);
+            }
+            PolyDestroy(&power);
+        }
+
+        PolyDestroy(&product);
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+    }
+
+    fprintf(stderr, "%d pairs, %d errors\n", TRUNC_TEST_PAIRS, errors);
+
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/** @file
+  Implementation of the profiling with the performance counters of Linux,
+  see perf_event_open(2). The counters form one group, so they are read
+  together by one system call. A kernel of the library is measured
+  from its outermost call, the recursive calls inside are a part of it.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _GNU_SOURCE
+
+#include "profile.h"
+#include "poly.h"
+#include "stats.h"
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * This is the number of the counters.
+ */
+#define PROFILE_EVENTS 7
+
+/**
+ * This is a counter.
+ */
+typedef struct {
+    const char *name;   ///< name in the summary
+    uint32_t type;      ///< type of perf_event_attr
+    uint64_t config;    ///< config of perf_event_attr
+} event;
+
+/** The counters, the software ones are there when the hardware ones are not. */
+static const event events[PROFILE_EVENTS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"task_clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+};
+
+/** The names of the kernels in the summary. */
+static const char *const kernelNames[POLY_KERNELS] = {
+    [POLY_KERNEL_MUL] = "noCoeffMul",
+    [POLY_KERNEL_CLEAN] = "PolyMonosClean"
+};
+
+/**
+ * These are the counts of the lines of a kind or of a kernel.
+ */
+typedef struct {
+    size_t calls;                        ///< number of lines or of outermost calls
+    uint64_t counts[PROFILE_EVENTS];     ///< counts of the opened counters
+} tally;
+
+/** The descriptor of the leader of the group, -1 if the profiling is off. */
+static int leader = -1;
+
+/** The number of the opened counters. */
+static size_t opened = 0;
+
+/** The indices in events of the opened counters, in the order of the group. */
+static size_t which[PROFILE_EVENTS];
+
+/** The last values read. */
+static uint64_t last[PROFILE_EVENTS];
+
+/** The counts of the kinds of lines. */
+static tally Lines[STATS_KINDS];
+
+/** The counts of the kernels. */
+static tally Kernels[POLY_KERNELS];
+
+/** The values when the current line started. */
+static uint64_t lineBefore[PROFILE_EVENTS];
+
+/** The values when the outermost calls of the kernels started. */
+static uint64_t kernelBefore[POLY_KERNELS][PROFILE_EVENTS];
+
+/** The numbers of the nested calls of the kernels. */
+static size_t depths[POLY_KERNELS];
+
+/**
+ * The function reads the values of the group. If the reading fails,
+ * the last values are given, so nothing is counted.
+ * @param[out] values : values of the opened counters
+ */
+static void readCounters(uint64_t values[]) {
+    struct {
+        uint64_t nr;
+        uint64_t values[PROFILE_EVENTS];
+    } group;
+
+    ssize_t size = read(leader, &group, sizeof(group));
+    if (size >= (ssize_t) sizeof(uint64_t) && group.nr == opened &&
+        (size_t) size == (opened + 1) * sizeof(uint64_t)) {
+        memcpy(last, group.values, opened * sizeof(uint64_t));
+    }
+    memcpy(values, last, opened * sizeof(uint64_t));
+}
+
+/**
+ * The function adds the values read now minus the earlier ones to the tally.
+ * @param[in,out] Tally : tally
+ * @param[in] before : earlier values
+ */
+static void count(tally *Tally, const uint64_t before[]) {
+    uint64_t now[PROFILE_EVENTS];
+    readCounters(now);
+
+    ++Tally->calls;
+    for (size_t i = 0; i < opened; ++i) {
+        Tally->counts[i] += now[i] - before[i];
+    }
+}
+
+/**
+ * The function is called when a kernel starts, see PolyProbes.
+ * @param[in] kernel : kernel
+ */
+static void enter(PolyKernel kernel) {
+    if (depths[kernel]++ == 0) {
+        readCounters(kernelBefore[kernel]);
+    }
+}
+
+/**
+ * The function is called when a kernel ends, see PolyProbes.
+ * @param[in] kernel : kernel
+ */
+static void leave(PolyKernel kernel) {
+    if (depths[kernel] > 0 && --depths[kernel] == 0) {
+        count(&(Kernels[kernel]), kernelBefore[kernel]);
+    }
+}
+
+bool ProfileStart(void) {
+    for (size_t i = 0; i < PROFILE_EVENTS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+        if (fd >= 0) {
+            if (leader < 0) {
+                leader = fd;
+            }
+            which[opened] = i;
+            ++opened;
+        }
+    }
+
+    if (leader >= 0) {
+        PolyProbes probes = {.enter = enter, .leave = leave};
+        PolySetProbes(&probes);
+    }
+
+    return leader >= 0;
+}
+
+void ProfileBegin(void) {
+    if (leader < 0) {
+        return;
+    }
+
+    // A task stopped by PolyRun does not leave its kernels.
+    memset(depths, 0, sizeof(depths));
+    readCounters(lineBefore);
+}
+
+void ProfileEnd(size_t kind) {
+    if (leader >= 0) {
+        count(&(Lines[kind]), lineBefore);
+    }
+}
+
+/**
+ * The function writes the counts of the lines of a kind or of a kernel.
+ * @param[in] scope : LINE or KERNEL
+ * @param[in] name : name of the kind or of the kernel
+ * @param[in] Tally : counts
+ */
+static void printTally(const char *scope, const char *name, const tally *Tally) {
+    fprintf(stderr, "PROFILE %s %s calls %zu", scope, name, Tally->calls);
+    for (size_t i = 0; i < opened; ++i) {
+        fprintf(stderr, " %s %llu", events[which[i]].name, (unsigned long long) Tally->counts[i]);
+    }
+    fputc('\n', stderr);
+}
+
+void ProfileReport(void) {
+    if (leader < 0) {
+        return;
+    }
+
+    fprintf(stderr, "PROFILE EVENTS");
+    for (size_t i = 0; i < opened; ++i) {
+        fprintf(stderr, " %s", events[which[i]].name);
+    }
+    fputc('\n', stderr);
+
+    for (size_t kind = 0; kind < STATS_KINDS; ++kind) {
+        if (Lines[kind].calls > 0) {
+            printTally("LINE", StatsName(kind), &(Lines[kind]));
+        }
+    }
+    for (size_t kernel = 0; kernel < POLY_KERNELS; ++kernel) {
+        if (Kernels[kernel].calls > 0) {
+            printTally("KERNEL", kernelNames[kernel], &(Kernels[kernel]));
+        }
+    }
+}
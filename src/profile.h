@@ -0,0 +1,47 @@
+/** @file
+  Interface of the profiling of the lines of the calculator and of the kernels
+  of the polynomial library with the hardware performance counters of Linux
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The function opens the performance counters of the calling thread
+ * and sets the probes of the kernels, see PolySetProbes, so it has to be
+ * called before any polynomial is created. The counters the processor
+ * does not have are left out.
+ * @return Was any counter opened?
+ */
+bool ProfileStart(void);
+
+/**
+ * The function notes the counters before a line is performed.
+ * It does nothing unless the profiling is started.
+ */
+void ProfileBegin(void);
+
+/**
+ * The function adds the counts since ProfileBegin to the kind of the line,
+ * see stats.h. It does nothing unless the profiling is started.
+ * @param[in] kind : kind of the line
+ */
+void ProfileEnd(size_t kind);
+
+/**
+ * The function writes the counts of every kind of lines and of every kernel
+ * to the standard error, one line each: "PROFILE LINE name" or
+ * "PROFILE KERNEL name" followed by the number of calls and the pairs
+ * of the name of a counter and its count. The first line,
+ * "PROFILE EVENTS", names the counters which were opened.
+ * It does nothing unless the profiling is started.
+ */
+void ProfileReport(void);
+
+#endif /* __PROFILE_H__ */
@@ -0,0 +1,355 @@
+/** @file
+  Implementation of the compiled programs of the calculator.
+  The peephole optimizations are applied while the instructions are
+  appended, looking only at the end of the program written so far.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "program.h"
+#include "command.h"
+#include "mallocSafe.h"
+#include "output.h"
+#include "polyMemo.h"
+#include "reclaim.h"
+#include "savePoly.h"
+#include <string.h>
+
+/**
+ * These are the kinds of instructions.
+ */
+typedef enum {
+    CODE_COMMAND,     ///< command performed by Execute, the operand is its text
+    CODE_PUSH,        ///< push of the constant with the index equal to the operand
+    CODE_WRONG_POLY,  ///< wrong polynomial
+    CODE_CLONE_POP,   ///< CLONE and POP on consecutive lines
+    CODE_ADD_MANY     ///< ADD on the operand consecutive lines
+} code;
+
+/**
+ * This is the instruction of a program.
+ */
+typedef struct {
+    code kind;            ///< kind of instruction
+    opcode op;            ///< command, for CODE_COMMAND
+    size_t numberofLine;  ///< number of the line of the instruction
+    size_t operand;       ///< operand
+    size_t length;        ///< number of characters of the text, for CODE_COMMAND
+} instruction;
+
+struct program {
+    instruction *code;     ///< array of instructions
+    size_t size;           ///< number of instructions
+    size_t capacity;       ///< size of the array of instructions
+    Poly *constants;       ///< pool of constants
+    size_t count;          ///< number of constants
+    size_t room;           ///< size of the pool of constants
+    char *text;            ///< parameters of the commands, each ending with 0
+    size_t length;         ///< number of characters of the parameters
+    size_t space;          ///< size of the array of parameters
+};
+
+/**
+ * A simple function that returns approximately twice the value.
+ * @param[in] n : integer
+ * @return result
+ */
+static size_t more(size_t n) {
+    return 2 * n + 16;
+}
+
+/**
+ * The function puts a constant into the pool.
+ * @param[in,out] Program : program
+ * @param[in] p : polynomial
+ * @return index of the constant
+ */
+static size_t addConstant(program *Program, Poly p) {
+    if (Program->count == Program->room) {
+        Program->room = more(Program->room);
+        Program->constants = (Poly *) realloc(Program->constants, Program->room * sizeof(Poly));
+        if (Program->constants == NULL) {
+            exit(1);
+        }
+    }
+    Program->constants[Program->count] = p;
+
+    return Program->count++;
+}
+
+/**
+ * The function copies the text of a line into the program.
+ * @param[in,out] Program : program
+ * @param[in] Line : line
+ * @return index of the beginning of the text
+ */
+static size_t addText(program *Program, const line *Line) {
+    while (Program->space - Program->length < Line->numberofLetters + 1) {
+        Program->space = more(Program->space);
+        Program->text = (char *) realloc(Program->text, Program->space);
+        if (Program->text == NULL) {
+            exit(1);
+        }
+    }
+    size_t start = Program->length;
+    memcpy(Program->text + start, Line->letters, Line->numberofLetters);
+    Program->text[start + Line->numberofLetters] = 0;
+    Program->length += Line->numberofLetters + 1;
+
+    return start;
+}
+
+/**
+ * The function returns the instruction counted from the end of the program.
+ * @param[in] Program : program
+ * @param[in] i : 1 for the last instruction, 2 for the one before, and so on
+ * @return instruction, NULL if there is no such instruction
+ */
+static instruction *last(program *Program, size_t i) {
+    return Program->size >= i ? &(Program->code[Program->size - i]) : NULL;
+}
+
+/**
+ * The function checks if the instruction is the given command.
+ * @param[in] Instruction : instruction or NULL
+ * @param[in] op : command
+ * @return Is it the command?
+ */
+static bool isCommand(const instruction *Instruction, opcode op) {
+    return Instruction != NULL && Instruction->kind == CODE_COMMAND && Instruction->op == op;
+}
+
+/**
+ * The function checks if the instruction pushes a constant.
+ * @param[in] Instruction : instruction or NULL
+ * @return Does it push a constant?
+ */
+static bool isPush(const instruction *Instruction) {
+    return Instruction != NULL && Instruction->kind == CODE_PUSH;
+}
+
+/**
+ * The function tries to combine the instruction with the end of the program.
+ * Only combinations which print the same output and errors are made.
+ * @param[in,out] Program : program
+ * @param[in] Instruction : instruction
+ * @return Has the instruction been combined?
+ */
+static bool combine(program *Program, const instruction *Instruction) {
+    instruction *a = last(Program, 2);
+    instruction *b = last(Program, 1);
+
+    if (Instruction->kind != CODE_COMMAND) {
+        return false;
+    }
+
+    switch (Instruction->op) {
+        case OP_ADD:
+        case OP_MUL:
+        case OP_SUB:
+            // Two constants on the stack cannot underflow. A product found
+            // by the cache is counted by MEMO, so it is left to the run.
+            if (isPush(a) && isPush(b) && !(Instruction->op == OP_MUL && PolyMemoIsOn())) {
+                Poly *p = &(Program->constants[b->operand]);
+                Poly *q = &(Program->constants[a->operand]);
+                Poly r = Instruction->op == OP_ADD ? PolyAdd(p, q) :
+                         Instruction->op == OP_MUL ? PolyMul(p, q) : PolySub(p, q);
+                PolyDestroy(p);
+                PolyDestroy(q);
+                *p = PolyZero();
+                *q = r;
+                --Program->size;
+                return true;
+            }
+            if (Instruction->op == OP_ADD && b != NULL &&
+                b->numberofLine + (b->kind == CODE_ADD_MANY ? b->operand : 1) ==
+                Instruction->numberofLine) {
+                if (b->kind == CODE_ADD_MANY) {
+                    ++b->operand;
+                    return true;
+                }
+                if (isCommand(b, OP_ADD)) {
+                    b->kind = CODE_ADD_MANY;
+                    b->operand = 2;
+                    return true;
+                }
+            }
+            return false;
+        case OP_NEG:
+            if (isPush(b)) {
+                Poly *p = &(Program->constants[b->operand]);
+                Poly r = PolyNeg(p);
+                PolyDestroy(p);
+                *p = r;
+                return true;
+            }
+            return false;
+        case OP_POP:
+            if (isPush(b)) {
+                PolyDestroy(&(Program->constants[b->operand]));
+                Program->constants[b->operand] = PolyZero();
+                --Program->size;
+                return true;
+            }
+            if (isCommand(b, OP_CLONE) && b->numberofLine + 1 == Instruction->numberofLine) {
+                b->kind = CODE_CLONE_POP;
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+/**
+ * The function appends the instruction to the program,
+ * combining it with the end of the program if possible.
+ * @param[in,out] Program : program
+ * @param[in] Instruction : instruction
+ */
+static void append(program *Program, instruction Instruction) {
+    if (combine(Program, &Instruction)) {
+        return;
+    }
+    if (Program->size == Program->capacity) {
+        Program->capacity = more(Program->capacity);
+        Program->code = (instruction *) realloc(Program->code,
+                                                Program->capacity * sizeof(instruction));
+        if (Program->code == NULL) {
+            exit(1);
+        }
+    }
+    Program->code[Program->size] = Instruction;
+    ++Program->size;
+}
+
+program *Compile(int fd) {
+    program *Program = (program *) mallocSafe(sizeof(program));
+    *Program = (program) {.code = NULL, .size = 0, .capacity = 0,
+                          .constants = NULL, .count = 0, .room = 0,
+                          .text = NULL, .length = 0, .space = 0};
+
+    lineReader *Reader = OpenReader(fd);
+    line Line;
+    size_t numberofLine = 0;
+
+    while (NextLine(Reader, &Line)) {
+        ++numberofLine;
+        if (Line.numberofLetters == 0 || Line.letters[0] == '#') {
+            continue;
+        }
+
+        instruction Instruction = {.numberofLine = numberofLine, .op = OP_WRONG,
+                                   .operand = 0, .length = 0};
+        Poly p;
+        if (IsCommand(&Line)) {
+            Instruction.kind = CODE_COMMAND;
+            Instruction.op = Decode(&Line);
+            if (Instruction.op >= OP_DEG_BY) {
+                Instruction.operand = addText(Program, &Line);
+                Instruction.length = Line.numberofLetters;
+            }
+        } else if (ParsePoly(Line.letters, Line.numberofLetters, &p)) {
+            Instruction.kind = CODE_PUSH;
+            Instruction.operand = addConstant(Program, p);
+        } else {
+            Instruction.kind = CODE_WRONG_POLY;
+        }
+        append(Program, Instruction);
+    }
+
+    CloseReader(Reader);
+
+    return Program;
+}
+
+/**
+ * The function adds the polynomials from the top of the stack in one pass:
+ * the monomials of all of them are gathered and sorted together.
+ * @param[in,out] Stack : stack
+ * @param[in] count : number of polynomials, at least 2
+ */
+static void addMany(stack *Stack, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const Poly *p = &(Stack->Array[Stack->top - 1 - i]);
+        total += PolyIsCoeff(p) ? 1 : PolyLength(p);
+    }
+
+    Mono *monos = (Mono *) PolyMalloc(total * sizeof(Mono));
+    size_t k = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Poly p = Pop(Stack);
+        PolyUnshare(&p);
+        if (PolyIsCoeff(&p)) {
+            monos[k++] = (Mono) {.p = p, .exp = 0};
+        } else {
+            for (size_t j = 0; j < PolyLength(&p); ++j) {
+                monos[k++] = PolyGetMono(&p, j);
+            }
+            PolyFreeMonos(&p);
+        }
+    }
+
+    Push(Stack, PolyOwnNormalMonos(k, monos));
+}
+
+void RunProgram(program *Program, stack *Stack, bool consume) {
+    for (size_t i = 0; i < Program->size; ++i) {
+        const instruction *Instruction = &(Program->code[i]);
+        switch (Instruction->kind) {
+            case CODE_PUSH: {
+                Poly *p = &(Program->constants[Instruction->operand]);
+                if (consume) {
+                    Push(Stack, *p);
+                    *p = PolyZero();
+                } else {
+                    Push(Stack, PolyClone(p));
+                }
+                break;
+            }
+            case CODE_WRONG_POLY:
+                OutputError(Instruction->numberofLine, "WRONG POLY");
+                break;
+            case CODE_CLONE_POP:
+                if (Empty(Stack)) {
+                    OutputError(Instruction->numberofLine, "STACK UNDERFLOW");
+                    OutputError(Instruction->numberofLine + 1, "STACK UNDERFLOW");
+                }
+                break;
+            case CODE_ADD_MANY: {
+                // With s polynomials on the stack the first s - 1 additions succeed.
+                size_t done = Stack->top < 2 ? 0 : (size_t) Stack->top - 1;
+                if (done > Instruction->operand) {
+                    done = Instruction->operand;
+                }
+                if (done > 0) {
+                    addMany(Stack, done + 1);
+                }
+                for (size_t j = done; j < Instruction->operand; ++j) {
+                    OutputError(Instruction->numberofLine + j, "STACK UNDERFLOW");
+                }
+                break;
+            }
+            default: {
+                line Line = {.letters = "", .numberofLetters = Instruction->length};
+                if (Instruction->op >= OP_DEG_BY) {
+                    Line.letters = Program->text + Instruction->operand;
+                }
+                Execute(Instruction->op, &Line, Stack, Instruction->numberofLine);
+                break;
+            }
+        }
+    }
+}
+
+void FreeProgram(program *Program) {
+    for (size_t i = 0; i < Program->count; ++i) {
+        PolyDestroyDeferred(&(Program->constants[i]));
+    }
+    free(Program->constants);
+    free(Program->code);
+    free(Program->text);
+    free(Program);
+}
@@ -0,0 +1,47 @@
+/** @file
+  Interface of the compiled programs of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __PROGRAM_H__
+#define __PROGRAM_H__
+
+#include "stack.h"
+
+/**
+ * This is the compiled program: an array of instructions, the pool of
+ * the parsed polynomial literals and the text of the command parameters.
+ */
+typedef struct program program;
+
+/**
+ * The function reads the whole input from the file descriptor and compiles it.
+ * Every polynomial is parsed once into the pool of constants and every
+ * command is decoded once. Then the peephole optimizations are run:
+ * arithmetic on constants is folded, a pushed constant which is popped at once
+ * is dropped, CLONE followed by POP is cancelled and chains of ADD are summed
+ * in one pass. The optimizations do not change the output nor the error messages.
+ * @param[in] fd : file descriptor
+ * @return program
+ */
+program *Compile(int fd);
+
+/**
+ * The function performs the program on the stack. If @p consume is set,
+ * the constants are moved to the stack instead of being copied, then
+ * the program can not be run again.
+ * @param[in,out] Program : program
+ * @param[in,out] Stack : stack
+ * @param[in] consume : can the constants be moved?
+ */
+void RunProgram(program *Program, stack *Stack, bool consume);
+
+/**
+ * The function removes the program from memory.
+ * @param[in] Program : program
+ */
+void FreeProgram(program *Program);
+
+#endif /* __PROGRAM_H__ */
@@ -0,0 +1,301 @@
+/** @file
+  Implementation of the background reclamation of large polynomials.
+  Polynomials are pushed onto a lock-free list, the reclamation thread
+  takes the whole list at once and frees it. Every polynomial remembers
+  the counter of the thread which handed it over, so a thread can wait
+  for its own polynomials only. The shared polynomials are counted
+  in a hash table keyed by their arrays of monomials.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "reclaim.h"
+#include "mallocSafe.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * This is the element of the list of polynomials waiting to be freed.
+ */
+typedef struct reclaimNode {
+    Poly p;                    ///< polynomial
+    size_t *owed;              ///< counter of the thread which handed it over
+    struct reclaimNode *next;  ///< next element
+} reclaimNode;
+
+/** The list of polynomials waiting to be freed. */
+static _Atomic(reclaimNode *) pending = NULL;
+
+/** The number of the polynomials of this thread handed over and not freed yet. */
+static _Thread_local size_t owed = 0;
+
+/** The lock of the counters of the threads. */
+static pthread_mutex_t owedLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Signalled when the counter of a thread drops to zero. */
+static pthread_cond_t drained = PTHREAD_COND_INITIALIZER;
+
+/** The key whose destructor waits for the polynomials of an ending thread. */
+static pthread_key_t drainKey;
+
+/** The semaphore counting the wake-ups of the reclamation thread. */
+static sem_t wakeUp;
+
+/** Guard of the start of the reclamation thread. */
+static pthread_once_t started = PTHREAD_ONCE_INIT;
+
+/**
+ * This is the number of extra references to a shared array of monomials.
+ */
+typedef struct share {
+    const void *arr;     ///< array of monomials
+    size_t refs;         ///< number of references besides the first one
+    struct share *next;  ///< next element in the same bucket
+} share;
+
+/** The buckets of the table of shared arrays. */
+static share **shares = NULL;
+
+/** The number of buckets, a power of two. */
+static size_t sizeofShares = 0;
+
+/** The number of shared arrays. */
+static atomic_size_t sharedCount = 0;
+
+/** The lock of the table of shared arrays. */
+static pthread_mutex_t sharesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The function gives the bucket of the array of monomials.
+ * @param[in] arr : array of monomials
+ * @return link to the first element of the bucket
+ */
+static share **bucket(const void *arr) {
+    uint64_t h = (uint64_t) (uintptr_t) arr * 0x9E3779B97F4A7C15ULL;
+
+    return &(shares[(h >> 32) & (sizeofShares - 1)]);
+}
+
+/**
+ * The function doubles the number of buckets of the table of shared arrays.
+ */
+static void growShares(void) {
+    share **old = shares;
+    size_t size = sizeofShares;
+
+    sizeofShares = size == 0 ? 64 : 2 * size;
+    shares = (share **) mallocSafe(sizeofShares * sizeof(share *));
+    memset(shares, 0, sizeofShares * sizeof(share *));
+    for (size_t i = 0; i < size; ++i) {
+        while (old[i] != NULL) {
+            share *s = old[i];
+            old[i] = s->next;
+            share **link = bucket(s->arr);
+            s->next = *link;
+            *link = s;
+        }
+    }
+    free(old);
+}
+
+/**
+ * The function finds the array of monomials in the table of shared arrays.
+ * Must be called with the lock of the table held.
+ * @param[in] arr : array of monomials
+ * @return link to the element of the array, NULL if the array is not shared
+ */
+static share **findShare(const void *arr) {
+    if (sizeofShares == 0) {
+        return NULL;
+    }
+
+    for (share **link = bucket(arr); *link != NULL; link = &((*link)->next)) {
+        if ((*link)->arr == arr) {
+            return link;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * The function drops one extra reference to the array of monomials.
+ * Must be called with the lock of the table held.
+ * @param[in] link : link to the element of the array
+ */
+static void dropShare(share **link) {
+    share *s = *link;
+
+    if (--s->refs == 0) {
+        *link = s->next;
+        free(s);
+        atomic_fetch_sub(&sharedCount, 1);
+    }
+}
+
+/**
+ * The function frees all the polynomials from the list.
+ * @param[in] list : list of polynomials
+ */
+static void freeList(reclaimNode *list) {
+    while (list != NULL) {
+        reclaimNode *next = list->next;
+        PolyDestroy(&(list->p));
+
+        pthread_mutex_lock(&owedLock);
+        if (--*(list->owed) == 0) {
+            pthread_cond_broadcast(&drained);
+        }
+        pthread_mutex_unlock(&owedLock);
+
+        free(list);
+        list = next;
+    }
+}
+
+/**
+ * The main function of the reclamation thread.
+ * @param[in] arg : unused
+ * @return NULL
+ */
+static void *reclaimer(void *arg) {
+    (void) arg;
+
+    while (true) {
+        while (sem_wait(&wakeUp) != 0) {
+        }
+        freeList(atomic_exchange(&pending, NULL));
+    }
+
+    return NULL;
+}
+
+/**
+ * The function is called when a thread which has handed polynomials over ends,
+ * its counter must outlive them.
+ * @param[in] value : unused
+ */
+static void drainAtExit(void *value) {
+    (void) value;
+    ReclaimDrain();
+}
+
+/**
+ * The function starts the reclamation thread.
+ */
+static void startReclaimer(void) {
+    pthread_t thread;
+
+    if (sem_init(&wakeUp, 0, 0) != 0 || pthread_key_create(&drainKey, drainAtExit) != 0 ||
+        pthread_create(&thread, NULL, reclaimer, NULL) != 0) {
+        exit(1);
+    }
+    pthread_detach(thread);
+}
+
+void PolyDestroyDeferred(Poly *p) {
+    assert(p != NULL);
+
+    if (!PolyIsCoeff(p) && atomic_load(&sharedCount) != 0) {
+        pthread_mutex_lock(&sharesLock);
+        share **link = findShare(p->exps);
+        if (link != NULL) {
+            dropShare(link);
+        }
+        pthread_mutex_unlock(&sharesLock);
+        if (link != NULL) {
+            *p = PolyZero();
+            return;
+        }
+    }
+
+    if (PolyCountMonos(p, RECLAIM_THRESHOLD) < RECLAIM_THRESHOLD) {
+        PolyDestroy(p);
+    } else {
+        pthread_once(&started, startReclaimer);
+
+        reclaimNode *node = (reclaimNode *) mallocSafe(sizeof(reclaimNode));
+        node->p = *p;
+        node->owed = &owed;
+
+        pthread_mutex_lock(&owedLock);
+        if (owed++ == 0) {
+            pthread_setspecific(drainKey, &owed);
+        }
+        pthread_mutex_unlock(&owedLock);
+
+        node->next = atomic_load(&pending);
+        while (!atomic_compare_exchange_weak(&pending, &(node->next), node)) {
+        }
+
+        sem_post(&wakeUp);
+    }
+    *p = PolyZero();
+}
+
+void ReclaimDrain(void) {
+    pthread_mutex_lock(&owedLock);
+    while (owed != 0) {
+        pthread_cond_wait(&drained, &owedLock);
+    }
+    pthread_mutex_unlock(&owedLock);
+}
+
+Poly PolyShare(const Poly *p) {
+    if (PolyIsCoeff(p) || PolyIsTerm(p)) {
+        return *p;
+    }
+
+    pthread_mutex_lock(&sharesLock);
+    if (atomic_load(&sharedCount) >= sizeofShares) {
+        growShares();
+    }
+    share **link = findShare(p->exps);
+    if (link == NULL) {
+        link = bucket(p->exps);
+        share *s = (share *) mallocSafe(sizeof(share));
+        *s = (share) {.arr = p->exps, .refs = 0, .next = *link};
+        *link = s;
+        atomic_fetch_add(&sharedCount, 1);
+    }
+    ++(*link)->refs;
+    pthread_mutex_unlock(&sharesLock);
+
+    return *p;
+}
+
+void PolyUnshare(Poly *p) {
+    if (PolyIsCoeff(p) || atomic_load(&sharedCount) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&sharesLock);
+    bool shared = findShare(p->exps) != NULL;
+    pthread_mutex_unlock(&sharesLock);
+    if (!shared) {
+        return;
+    }
+
+    // The copy can be large, so it is made without the lock. The array stays
+    // alive meanwhile, because the reference of the caller is not dropped yet.
+    Poly copy = PolyClone(p);
+
+    pthread_mutex_lock(&sharesLock);
+    share **link = findShare(p->exps);
+    if (link != NULL) {
+        dropShare(link);
+    }
+    pthread_mutex_unlock(&sharesLock);
+
+    if (link == NULL) {
+        // The other references were dropped meanwhile, the array is the caller's alone.
+        PolyDestroy(p);
+    }
+    *p = copy;
+}
@@ -0,0 +1,51 @@
+/** @file
+  Interface of the background reclamation of large polynomials
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __RECLAIM_H__
+#define __RECLAIM_H__
+
+#include "poly.h"
+
+/**
+ * The number of monomials from which a polynomial is freed in the background.
+ */
+#define RECLAIM_THRESHOLD 65536
+
+/**
+ * The function removes a polynomial from memory. Small polynomials are freed
+ * at once, polynomials of at least RECLAIM_THRESHOLD monomials are handed
+ * to the reclamation thread and the function returns immediately.
+ * A shared polynomial only loses one reference, see PolyShare.
+ * @param[in] p : polynomial
+ */
+void PolyDestroyDeferred(Poly *p);
+
+/**
+ * The function gives another reference to the polynomial without copying
+ * its monomials. The polynomial must not be changed while it is shared,
+ * every reference is removed by PolyDestroyDeferred and the monomials are
+ * freed together with the last one.
+ * @param[in] p : polynomial
+ * @return reference to the polynomial
+ */
+Poly PolyShare(const Poly *p);
+
+/**
+ * The function makes the polynomial private before it is changed in place:
+ * a shared polynomial is replaced with a copy and loses one reference.
+ * @param[in,out] p : polynomial
+ */
+void PolyUnshare(Poly *p);
+
+/**
+ * The function waits until the reclamation thread has freed all the polynomials
+ * handed over by the calling thread. The polynomials of the other threads
+ * are not waited for. A thread which ends waits for its polynomials by itself.
+ */
+void ReclaimDrain(void);
+
+#endif /* __RECLAIM_H__ */
@@ -0,0 +1,149 @@
+/** @file
+  Implementation of the named registers of the calculator.
+  The registers are kept in a hash table with chaining.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#include "registers.h"
+#include "mallocSafe.h"
+#include "reclaim.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * This is the register.
+ */
+typedef struct reg {
+    char *name;        ///< name of the register
+    size_t length;     ///< length of the name
+    uint64_t hash;     ///< hash of the name
+    Poly p;            ///< polynomial
+    struct reg *next;  ///< next register in the same bucket
+} reg;
+
+struct registers {
+    reg **buckets;         ///< buckets of the table
+    size_t sizeofBuckets;  ///< number of buckets, a power of two
+    size_t count;          ///< number of registers
+};
+
+/**
+ * The function computes the hash of the name.
+ * @param[in] name : name
+ * @param[in] length : length of the name
+ * @return hash
+ */
+static uint64_t nameHash(const char *name, size_t length) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+
+    for (size_t i = 0; i < length; ++i) {
+        h = (h ^ (unsigned char) name[i]) * 0x100000001B3ULL;
+    }
+
+    return h;
+}
+
+/**
+ * The function finds the register.
+ * @param[in] Registers : map of registers
+ * @param[in] name : name of the register
+ * @param[in] length : length of the name
+ * @param[in] hash : hash of the name
+ * @return register, NULL if there is none
+ */
+static reg *find(const registers *Registers, const char *name, size_t length, uint64_t hash) {
+    reg *r = Registers->buckets[hash & (Registers->sizeofBuckets - 1)];
+
+    while (r != NULL && (r->hash != hash || r->length != length ||
+                         memcmp(r->name, name, length) != 0)) {
+        r = r->next;
+    }
+
+    return r;
+}
+
+/**
+ * The function doubles the number of buckets.
+ * @param[in,out] Registers : map of registers
+ */
+static void grow(registers *Registers) {
+    size_t size = 2 * Registers->sizeofBuckets;
+    reg **buckets = (reg **) mallocSafe(size * sizeof(reg *));
+    memset(buckets, 0, size * sizeof(reg *));
+
+    for (size_t i = 0; i < Registers->sizeofBuckets; ++i) {
+        reg *r = Registers->buckets[i];
+        while (r != NULL) {
+            reg *next = r->next;
+            r->next = buckets[r->hash & (size - 1)];
+            buckets[r->hash & (size - 1)] = r;
+            r = next;
+        }
+    }
+
+    free(Registers->buckets);
+    Registers->buckets = buckets;
+    Registers->sizeofBuckets = size;
+}
+
+void RegisterStore(registers **Registers, const char *name, size_t length, Poly p) {
+    if (*Registers == NULL) {
+        *Registers = (registers *) mallocSafe(sizeof(registers));
+        (*Registers)->sizeofBuckets = 16;
+        (*Registers)->buckets = (reg **) mallocSafe(16 * sizeof(reg *));
+        memset((*Registers)->buckets, 0, 16 * sizeof(reg *));
+        (*Registers)->count = 0;
+    }
+
+    uint64_t hash = nameHash(name, length);
+    reg *r = find(*Registers, name, length, hash);
+    if (r != NULL) {
+        PolyDestroyDeferred(&(r->p));
+        r->p = p;
+        return;
+    }
+
+    if ((*Registers)->count == (*Registers)->sizeofBuckets) {
+        grow(*Registers);
+    }
+    r = (reg *) mallocSafe(sizeof(reg));
+    r->name = (char *) mallocSafe(length);
+    memcpy(r->name, name, length);
+    r->length = length;
+    r->hash = hash;
+    r->p = p;
+    r->next = (*Registers)->buckets[hash & ((*Registers)->sizeofBuckets - 1)];
+    (*Registers)->buckets[hash & ((*Registers)->sizeofBuckets - 1)] = r;
+    ++(*Registers)->count;
+}
+
+const Poly *RegisterFind(const registers *Registers, const char *name, size_t length) {
+    if (Registers == NULL) {
+        return NULL;
+    }
+
+    reg *r = find(Registers, name, length, nameHash(name, length));
+
+    return r == NULL ? NULL : &(r->p);
+}
+
+void RegistersFree(registers *Registers) {
+    if (Registers == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < Registers->sizeofBuckets; ++i) {
+        reg *r = Registers->buckets[i];
+        while (r != NULL) {
+            reg *next = r->next;
+            PolyDestroyDeferred(&(r->p));
+            free(r->name);
+            free(r);
+            r = next;
+        }
+    }
+    free(Registers->buckets);
+    free(Registers);
+}
@@ -0,0 +1,45 @@
+/** @file
+  Interface of the named registers of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __REGISTERS_H__
+#define __REGISTERS_H__
+
+#include "poly.h"
+
+/**
+ * This is the map from names to polynomials. The polynomials in the registers
+ * are shared with the stack, see PolyShare, so they are never copied
+ * by STORE nor RECALL.
+ */
+typedef struct registers registers;
+
+/**
+ * The function puts the polynomial into the register, replacing
+ * the polynomial held there before. The map is created if it does not exist.
+ * @param[in,out] Registers : map of registers, NULL if it is empty
+ * @param[in] name : name of the register
+ * @param[in] length : length of the name
+ * @param[in] p : polynomial taken over by the register
+ */
+void RegisterStore(registers **Registers, const char *name, size_t length, Poly p);
+
+/**
+ * The function finds the polynomial held in the register.
+ * @param[in] Registers : map of registers, NULL if it is empty
+ * @param[in] name : name of the register
+ * @param[in] length : length of the name
+ * @return polynomial, NULL if the register is empty
+ */
+const Poly *RegisterFind(const registers *Registers, const char *name, size_t length);
+
+/**
+ * The function removes all the registers from memory.
+ * @param[in] Registers : map of registers, NULL if it is empty
+ */
+void RegistersFree(registers *Registers);
+
+#endif /* __REGISTERS_H__ */
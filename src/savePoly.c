@@ -1,308 +1,445 @@
 /** @file
-  The file contains an implementation of the polynomial saving function
+  The file contains an implementation of the polynomial saving function.
+  The polynomial is parsed in a single pass from left to right. Every
+  polynomial that is still open keeps its monomials on an explicit stack,
+  so neither the time per character nor the C stack depends on the depth.
+  Very long lines are split at the outermost '+' signs and parsed on many threads.
 
   @author Maja Wiśniewska <mw429666.students.mimuw.edu.pl>
   @date 2021
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "mallocSafe.h"
+#include "output.h"
 #include <limits.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
-#include "stack.h"
-#include "line.h"
+#include <unistd.h>
+#include "savePoly.h"
 
-static void savePolyHelp(size_t start, size_t stop, const line *Line, Poly *p, bool *correctPoly);
+/**
+ * The length of a line from which the polynomial is parsed on many threads.
+ */
+#define PARALLEL_THRESHOLD (1 << 24)
 
 /**
- * The function looks for an index that distinguishes between the two coordinates of the monomial.
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @param[in] Line : line
- * @return comma index
+ * The smallest part of a line parsed by one thread.
  */
-static size_t searchComma(size_t start, size_t stop, const line *Line) {
-    size_t opening = 0;
-    size_t closing = 0;
+#define PARALLEL_CHUNK (1 << 22)
 
-    for (size_t i = start; i <= stop; ++i) {
-        if (Line->letters[i] == '(') {
-            ++opening;
-        }
-        if (Line->letters[i] == ')') {
-            ++closing;
-        }
-        if (Line->letters[i] == ',' && closing == opening) {
-            return i;
-        }
-    }
-    return 0;
-}
+/**
+ * The largest number of threads parsing one line.
+ */
+#define MAX_PARSERS 64
 
 /**
- * The function checks if the read exponent value is correct.
- * @param[in] Line : line
- * @param[in] x : exponent value
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @return Is the value correct?
+ * This is the list of monomials of a polynomial that is being parsed.
  */
-static bool correctExp(const line *Line, long int x, size_t start, size_t stop) {
-    bool correct = Line->letters[start] >= '0' && Line->letters[start] <= '9';
+typedef struct {
+    Mono *monos;      ///< array of monomials
+    size_t count;     ///< number of monomials
+    size_t capacity;  ///< array size
+} monoList;
 
-    if (x < 0 || x > INT_MAX || 
-    (x == 0 && !(Line->letters[start] == '0' && stop - start == 0))) {
-        correct = false;
-    }
+/**
+ * This is the stack of polynomials that are being parsed.
+ */
+typedef struct {
+    monoList *lists;  ///< array of lists of monomials
+    size_t size;      ///< number of lists on the stack
+    size_t capacity;  ///< array size
+} listStack;
 
-    if (strcmp(&(Line->letters[start]), "2147483647") == 0) {
-        correct = true;
+/**
+ * A simple function that returns approximately twice the value.
+ * @param[in] n : integer
+ * @return result
+ */
+static size_t more(size_t n) {
+    size_t result = 2 * n + 1;
+
+    return result;
+}
+
+/**
+ * The function puts an empty list of monomials on the stack.
+ * @param[in,out] Lists : stack of lists
+ */
+static void pushList(listStack *Lists) {
+    if (Lists->size == Lists->capacity) {
+        Lists->capacity = more(Lists->capacity);
+        Lists->lists = (monoList *) realloc(Lists->lists, Lists->capacity * sizeof(monoList));
+        if (Lists->lists == NULL) {
+            exit(1);
+        }
     }
+    Lists->lists[Lists->size] = (monoList) {.monos = NULL, .count = 0, .capacity = 0};
+    ++Lists->size;
+}
 
-    return correct;
+/**
+ * The function appends a monomial to the list.
+ * @param[in,out] List : list of monomials
+ * @param[in] p : coefficient of the monomial
+ * @param[in] exp : exponent of the monomial
+ */
+static void appendMono(monoList *List, Poly p, poly_exp_t exp) {
+    if (List->count == List->capacity) {
+        List->capacity = more(List->capacity);
+        List->monos = (Mono *) PolyRealloc(List->monos, List->capacity * sizeof(Mono));
+    }
+    List->monos[List->count] = (Mono) {.p = p, .exp = exp};
+    ++List->count;
 }
 
 /**
- * The function returns the exponent of the monomial on error
- * saves this fact in the variable correct.
- * @param[in] Line : line
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @param[out] correct : Is the polynomial correct?
- * @return the value of the exponent of the monomial
+ * The function frees all the lists on the stack together with their monomials.
+ * @param[in,out] Lists : stack of lists
  */
-static poly_exp_t saveExp(const line *Line, size_t start, size_t stop, bool *correct) {
-    poly_exp_t k;
+static void freeLists(listStack *Lists) {
+    for (size_t i = 0; i < Lists->size; ++i) {
+        for (size_t j = 0; j < Lists->lists[i].count; ++j) {
+            MonoDestroy(&(Lists->lists[i].monos[j]));
+        }
+        PolyFree(Lists->lists[i].monos);
+    }
+    free(Lists->lists);
+}
 
-    char *end;
+bool ParseCoeff(const char *letters, size_t length, size_t *i, poly_coeff_t *x) {
+    bool negative = *i < length && letters[*i] == '-';
+    poly_ucoeff_t limit = (poly_ucoeff_t) POLY_COEFF_MAX + (negative ? 1 : 0);
+    poly_ucoeff_t value = 0;
+    size_t digits = 0;
 
-    long int x = strtol(&(Line->letters[start]), &end, 10);
+    if (negative) {
+        ++*i;
+    }
+    while (*i < length && letters[*i] >= '0' && letters[*i] <= '9') {
+        poly_ucoeff_t digit = (poly_ucoeff_t) (letters[*i] - '0');
+        if (value > (limit - digit) / 10) {
+            return false;
+        }
+        value = 10 * value + digit;
+        ++digits;
+        ++*i;
+    }
 
-    if (correctExp(Line, x, start, stop) && end[0] == ')') {
-        k = (poly_exp_t) x;
-    } else {
-        *correct = false;
-        k = 0;
+    if (digits == 0 || (value == 0 && digits > 1)) {
+        return false;
     }
 
-    return k;
+    *x = negative ? (poly_coeff_t) (0 - value) : (poly_coeff_t) value;
+    return true;
 }
 
 /**
- * Writes to the monomial table the monomial that is between
- * with the given indices in the row.
- * @param[in] start : starting index on the row
- * @param[in] stop : end index on the line
- * @param[in] i : the index in the monomial array
- * @param[out] monos: table of monomials
- * @param[in] Line : line of characters
- * @param[in,out] correctPoly : Is the polynomial correct?
+ * The function reads the exponent starting at the index @p i.
+ * The exponent consists of digits only, it must fit in poly_exp_t
+ * and zero can only be written as "0".
+ * @param[in] letters : array of characters
+ * @param[in] length : number of characters
+ * @param[in,out] i : index, moved behind the exponent
+ * @param[out] x : value of the exponent
+ * @return Is the exponent correct?
  */
-static void saveMono(size_t start, size_t stop, size_t i, Mono *monos, 
-        const line *Line, bool *correctPoly) {
-    if (Line->letters[start] != '(') {
-        *correctPoly = false;
-        Poly p = PolyZero();
-        monos[i] = MonoFromPoly(&p, 1);
-    } else {
-        monos[i].p = PolyZero();
-        size_t comma = searchComma(start + 1, stop - 1, Line);
-        if (comma != 0) {
-            savePolyHelp(start + 1, comma - 1, Line, &(monos[i].p), correctPoly);
-            monos[i].exp = saveExp(Line, comma + 1, stop - 1, correctPoly);
-        } else {
-            *correctPoly = false;
-            monos[i].exp = 1;
+static bool readExp(const char *letters, size_t length, size_t *i, poly_exp_t *x) {
+    long long value = 0;
+    size_t digits = 0;
+
+    while (*i < length && letters[*i] >= '0' && letters[*i] <= '9') {
+        value = 10 * value + (letters[*i] - '0');
+        if (value > POLY_EXP_MAX) {
+            return false;
         }
+        ++digits;
+        ++*i;
+    }
+
+    if (digits == 0 || (value == 0 && digits > 1)) {
+        return false;
     }
+
+    *x = (poly_exp_t) value;
+    return true;
 }
 
 /**
- * The function checks if the read value of the coefficient is correct
- * @param[in] Line : line
- * @param[in] x : value of the coefficient
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @return Is the value correct?
+ * The function parses the characters in a single pass from left to right.
+ * If @p sum is NULL, the characters must be a polynomial, which is stored
+ * in @p p. Otherwise they must be a sum of monomials, and the monomials
+ * are left in @p sum without being added together.
+ * @param[in] letters : array of characters
+ * @param[in] length : number of characters
+ * @param[out] p : polynomial
+ * @param[out] sum : list of monomials
+ * @return Are the characters correct?
  */
-static bool correctCoeff(const line *Line, llint x, size_t start, size_t stop) {
-    bool correct = Line->letters[start] == '-' ||
-    (Line->letters[start] >= '0' && Line->letters[start] <= '9');
-    for (size_t i = start + 1; i <= stop; ++i) {
-        if (!(Line->letters[i] >= '0' && Line->letters[i] <= '9')) {
-            correct = false;
-        }
+static bool parse(const char *letters, size_t length, Poly *p, monoList *sum) {
+    listStack Lists = {.lists = NULL, .size = 0, .capacity = 0};
+    Poly current = PolyZero();
+    size_t i = 0;
+    bool correct = true;
+    bool done = false;
+
+    if (sum != NULL) {
+        pushList(&Lists);
+        correct = length > 0 && letters[0] == '(';
+        i = 1;
     }
 
-    if (x == LLONG_MIN || x == LLONG_MAX ||
-    (x == 0 && !(Line->letters[start] == '0' && stop - start == 0))) {
-        correct = false;
+    while (correct && !done) {
+        while (i < length && letters[i] == '(') {
+            pushList(&Lists);
+            ++i;
+        }
+
+        poly_coeff_t coeff = 0;
+        correct = ParseCoeff(letters, length, &i, &coeff);
+        current = PolyFromCoeff(coeff);
+
+        while (correct && !done) {
+            if (Lists.size == 0) {
+                correct = i == length;
+                done = true;
+            } else {
+                monoList *List = &(Lists.lists[Lists.size - 1]);
+                poly_exp_t exp;
+
+                correct = i < length && letters[i] == ',';
+                ++i;
+                correct = correct && readExp(letters, length, &i, &exp);
+                correct = correct && i < length && letters[i] == ')';
+                ++i;
+
+                if (correct) {
+                    appendMono(List, current, exp);
+                    current = PolyZero();
+                    if (i < length && letters[i] == '+') {
+                        correct = i + 1 < length && letters[i + 1] == '(';
+                        i = i + 2;
+                        break;
+                    }
+                    if (sum != NULL && Lists.size == 1) {
+                        correct = i == length;
+                        done = true;
+                    } else {
+                        current = PolyOwnNormalMonos(List->count, List->monos);
+                        --Lists.size;
+                    }
+                }
+            }
+        }
     }
 
-    if (stop - start == 1 && Line->letters[start] == '-' && Line->letters[stop] == '0') {
-        correct = true; 
+    if (correct && sum != NULL) {
+        *sum = Lists.lists[0];
+        Lists.size = 0;
     }
+    freeLists(&Lists);
 
-    if (strcmp(&(Line->letters[start]), "-9223372036854775808") == 0 ||
-        strcmp(&(Line->letters[start]), "9223372036854775807") == 0) {
-        correct = true;
+    if (correct && sum == NULL) {
+        *p = current;
+    } else {
+        PolyDestroy(&current);
     }
 
     return correct;
 }
 
 /**
-  * Writes a constant polynomial that is between the given indices on a line.
- * If there is an error when loading the polynomial, it saves
- * this fact on the correctPoly variable.
- * @param[in] Line : line
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @param[out] correctPoly : Is the polynomial correct?
- * @param[out] p : polynomial
+ * This is the part of a long line handled by one thread of the parallel parser.
  */
-static void saveCoeff(const line *Line, size_t start, size_t stop, bool *correctPoly, Poly *p) {
-    char* end;
-    llint x = strtoll(&(Line->letters[start]), &end, 10);
+typedef struct {
+    const char *letters;  ///< array of characters of the whole line
+    size_t length;        ///< number of characters of the whole line
+    size_t start;         ///< beginning of the part
+    size_t stop;          ///< end of the part (exclusive)
+    long long depth;      ///< change of the depth of parentheses, then the depth at the beginning
+    size_t split;         ///< first '+' outside parentheses at or after the beginning
+    monoList sum;         ///< parsed monomials
+    bool correct;         ///< Is the part correct?
+} chunk;
 
-    if (correctCoeff(Line, x, start, stop) && (end[0] == 0 || end[0] == ',')) {
-        *p = PolyFromCoeff(x);
-    } else {
-        *correctPoly = false;
+/**
+ * The function computes the change of the depth of parentheses in the part.
+ * @param[in,out] arg : part of the line
+ * @return NULL
+ */
+static void *chunkDepth(void *arg) {
+    chunk *Chunk = (chunk *) arg;
+    long long depth = 0;
+
+    for (size_t i = Chunk->start; i < Chunk->stop; ++i) {
+        depth += (Chunk->letters[i] == '(') - (Chunk->letters[i] == ')');
     }
+    Chunk->depth = depth;
+
+    return NULL;
 }
 
 /**
- * The function searches for the end of a given monomial.
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @param[in] Line : line
- * @return the index of the closing brace.
+ * The function finds the first '+' outside parentheses at or after the
+ * beginning of the part, knowing the depth at the beginning.
+ * @param[in,out] arg : part of the line
+ * @return NULL
  */
-static size_t searchClosePar(size_t start, size_t stop, const line *Line) {
-    size_t opening = 0;
-    size_t closing = 0;
-    for (size_t i = start; i <= stop; ++i) {
-        if (Line->letters[i] == '(') {
-            ++opening;
-        }
-        if (Line->letters[i] == ')') {
-            closing++;
-            if (closing == opening) {
-                return i;
-            }
-        }
+static void *chunkSplit(void *arg) {
+    chunk *Chunk = (chunk *) arg;
+    long long depth = Chunk->depth;
+    size_t i = Chunk->start;
+
+    while (i < Chunk->length && !(Chunk->letters[i] == '+' && depth == 0)) {
+        depth += (Chunk->letters[i] == '(') - (Chunk->letters[i] == ')');
+        ++i;
     }
-    return 0;
+    Chunk->split = i;
+
+    return NULL;
 }
 
 /**
- * The function counts how many monomials a given polynomial consists of.
- * @param[in] Line : line
- * @param[in] start : strting index
- * @param[in] stop : end index
- * @return number of monomials
+ * The function parses the monomials of the part.
+ * @param[in,out] arg : part of the line
+ * @return NULL
  */
-static size_t countMonos(const line *Line, size_t start, size_t stop) {
-    size_t opening = 0;
-    size_t closing = 0;
-    size_t monos = 1;
-
-    for (size_t i = start; i <= stop; ++i) {
-        if (Line->letters[i] == '(') {
-            ++opening;
-        }
-        if (Line->letters[i] == ')') {
-            ++closing;
-        }
-        if (Line->letters[i] == '+' && closing == opening) {
-            ++monos;
-        }
-    }
+static void *chunkParse(void *arg) {
+    chunk *Chunk = (chunk *) arg;
+
+    Chunk->sum = (monoList) {.monos = NULL, .count = 0, .capacity = 0};
+    Chunk->correct = parse(Chunk->letters + Chunk->start, Chunk->stop - Chunk->start,
+                           NULL, &(Chunk->sum));
 
-    return monos;
+    return NULL;
 }
 
 /**
- * The function writes monomials between the parentheses and checks that they are spelled correctly.
- * If there is an error when loading the polynomial, it saves
- * this fact on the correctPoly variable.
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @param[in] numberofMonos : the number of monomials in the array
- * @param[out] monos : table of monomials
- * @param[in] Line : line of characters
- * @param[out] correctPoly : Is the polynomial correct?
+ * The function calls the function for every part, each on a separate thread.
+ * The first part is handled by the calling thread. If a thread cannot be
+ * created, its part is handled by the calling thread as well.
+ * @param[in] function : function
+ * @param[in,out] chunks : array of parts
+ * @param[in] count : number of parts
  */
-static void PolySaveMonos(size_t start, size_t stop, size_t numberofMonos, Mono *monos,
-        const line *Line, bool *correctPoly) {
-    size_t openPar = start;
-    for (size_t i = 0; i < numberofMonos; ++i) {
-        size_t closePar = searchClosePar(openPar, stop, Line);
-        if (closePar > openPar + 1) {
-            saveMono(openPar, closePar, i, monos, Line, correctPoly);
+static void runParallel(void *(*function)(void *), chunk *chunks, size_t count) {
+    pthread_t threads[MAX_PARSERS];
+    bool started[MAX_PARSERS];
+
+    for (size_t t = 1; t < count; ++t) {
+        started[t] = pthread_create(&(threads[t]), NULL, function, &(chunks[t])) == 0;
+    }
+    function(&(chunks[0]));
+    for (size_t t = 1; t < count; ++t) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
         } else {
-            *correctPoly = false;
-            Poly p = PolyZero();
-            monos[i] = MonoFromPoly(&p, 1);
-        }
-        if (stop > closePar + 1) {
-            if (Line->letters[closePar + 1] == '+') {
-                if (Line->numberofLetters == closePar + 2) {
-                    *correctPoly = false;
-                }
-            } else {
-                *correctPoly = false;
-            }
+            function(&(chunks[t]));
         }
-        openPar = closePar + 2;
     }
 }
 
 /**
- * Writes the polynomial that is between the given indices on a line.
- * If there is an error when loading the polynomial, it saves
- * this fact on the correctPoly variable.
- * @param[in] start : starting index
- * @param[in] stop : end index
- * @param[in] Line : line
- * @param[out] p : wielomian
- * @param[in,out] correctPoly : Is the polynomial correct?
+ * The function parses a long line starting with '(' on many threads.
+ * A structural scan splits the line at '+' signs outside parentheses,
+ * every part is parsed into its own array of monomials, and all the
+ * monomials are added together once at the end.
+ * @param[in] letters : array of characters
+ * @param[in] length : number of characters
+ * @param[in] count : number of threads
+ * @param[out] p : polynomial, set only if it is correct
+ * @return Is the polynomial correct?
  */
-static void savePolyHelp(size_t start, size_t stop, const line *Line, Poly *p, bool *correctPoly) {
-    if (Line->letters[start] == '(') {
-        size_t numberofMonos = countMonos(Line, start, stop);
-        Mono *monos = (Mono *) mallocSafe(numberofMonos * sizeof(Mono));
-        PolySaveMonos(start, stop, numberofMonos, monos, Line, correctPoly);
-        if (*correctPoly) {
-            *p = PolyAddMonos(numberofMonos, monos);
-        } else {
-            for (size_t i = 0; i < numberofMonos; ++i) {
-                MonoDestroy(&(monos[i]));
+static bool parseParallel(const char *letters, size_t length, size_t count, Poly *p) {
+    chunk chunks[MAX_PARSERS];
+
+    for (size_t t = 0; t < count; ++t) {
+        chunks[t].letters = letters;
+        chunks[t].length = length;
+        chunks[t].start = length / count * t;
+        chunks[t].stop = t + 1 == count ? length : length / count * (t + 1);
+    }
+
+    runParallel(chunkDepth, chunks, count);
+    long long depth = 0;
+    for (size_t t = 0; t < count; ++t) {
+        long long change = chunks[t].depth;
+        chunks[t].depth = depth;
+        depth += change;
+    }
+    runParallel(chunkSplit, chunks + 1, count - 1);
+
+    size_t parts = 0;
+    size_t begin = 0;
+    for (size_t t = 0; t < count; ++t) {
+        size_t end = t + 1 == count ? length : chunks[t + 1].split;
+        if (t == 0 || chunks[t].split < end) {
+            chunks[parts].start = begin;
+            chunks[parts].stop = end;
+            ++parts;
+            begin = end + 1;
+        }
+    }
+    runParallel(chunkParse, chunks, parts);
+
+    bool correct = true;
+    size_t total = 0;
+    for (size_t t = 0; t < parts; ++t) {
+        correct = correct && chunks[t].correct;
+        total += chunks[t].sum.count;
+    }
+
+    Mono *monos = NULL;
+    if (correct) {
+        monos = (Mono *) PolyMalloc(total * sizeof(Mono));
+    }
+    total = 0;
+    for (size_t t = 0; t < parts; ++t) {
+        for (size_t j = 0; j < chunks[t].sum.count; ++j) {
+            if (correct) {
+                monos[total] = chunks[t].sum.monos[j];
+                ++total;
+            } else {
+                MonoDestroy(&(chunks[t].sum.monos[j]));
             }
         }
-        free(monos);
-    } else {
-        saveCoeff(Line, start, stop, correctPoly, p);
+        PolyFree(chunks[t].sum.monos);
+    }
+
+    if (correct) {
+        *p = PolyOwnNormalMonos(total, monos);
     }
+
+    return correct;
 }
 
-void savePoly(const line *Line, stack *Stack, size_t numberofLine) {
-    bool correctPoly = true;
-    Poly p = PolyZero();
+bool ParsePoly(const char *letters, size_t length, Poly *p) {
+    if (length >= PARALLEL_THRESHOLD && letters[0] == '(') {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        size_t count = length / PARALLEL_CHUNK;
 
-    if (Line->letters[0] == '(') {
-        size_t end = searchClosePar(0, Line->numberofLetters - 1, Line);
-        if (end != Line->numberofLetters - 1) {
-            correctPoly = false;
+        if (processors > 0 && count > (size_t) processors) {
+            count = (size_t) processors;
+        }
+        if (count > MAX_PARSERS) {
+            count = MAX_PARSERS;
+        }
+        if (count > 1) {
+            return parseParallel(letters, length, count, p);
         }
     }
 
-    savePolyHelp(0, Line->numberofLetters - 1, Line, &p, &correctPoly);
-    if (correctPoly) {
+    return parse(letters, length, p, NULL);
+}
+
+void savePoly(const line *Line, stack *Stack, size_t numberofLine) {
+    Poly p;
+
+    if (ParsePoly(Line->letters, Line->numberofLetters, &p)) {
         Push(Stack, p);
     } else {
-        fprintf(stderr, "ERROR %ld WRONG POLY\n", numberofLine);
-        PolyDestroy(&p);
+        OutputError(numberofLine, "WRONG POLY");
     }
 }
@@ -8,6 +8,30 @@
 #ifndef __SAVEPOLY_H__
 #define __SAVEPOLY_H__
 
+#include "stack.h"
+#include "line.h"
+
+/**
+ * The function parses a polynomial written between the given characters.
+ * @param[in] letters : array of characters
+ * @param[in] length : number of characters
+ * @param[out] p : polynomial, set only if it is correct
+ * @return Is the polynomial correct?
+ */
+bool ParsePoly(const char *letters, size_t length, Poly *p);
+
+/**
+ * The function reads the coefficient starting at the index @p i.
+ * The coefficient is an optional minus and digits, it must fit in poly_coeff_t
+ * and zero can only be written as "0" or "-0".
+ * @param[in] letters : array of characters
+ * @param[in] length : number of characters
+ * @param[in,out] i : index, moved behind the coefficient
+ * @param[out] x : value of the coefficient
+ * @return Is the coefficient correct?
+ */
+bool ParseCoeff(const char *letters, size_t length, size_t *i, poly_coeff_t *x);
+
 /**
  * The function reads the polynomial and inserts it if no error is found
  * on top of the stack, otherwise it prints the appropriate message.
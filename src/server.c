@@ -0,0 +1,181 @@
+/** @file
+  Implementation of the server mode of the calculator.
+  The main thread accepts the connections and puts them into a bounded
+  queue, the worker threads take them from the queue and run the sessions.
+  The output of a session goes to a stream of its own, see output.h,
+  which is written out before the session waits for the next line.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "server.h"
+#include "command.h"
+#include "mallocSafe.h"
+#include "output.h"
+#include "polyMemo.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * The number of accepted connections which can wait for a thread.
+ */
+#define SERVER_QUEUE 64
+
+/**
+ * This is the queue of the accepted connections.
+ */
+typedef struct {
+    int fds[SERVER_QUEUE];      ///< ring of the file descriptors
+    size_t first;               ///< index of the oldest connection
+    size_t count;               ///< number of the waiting connections
+    size_t memo;                ///< memory limit of the cache of a session
+    pthread_mutex_t lock;       ///< lock of the queue
+    pthread_cond_t notEmpty;    ///< raised when a connection is added
+    pthread_cond_t notFull;     ///< raised when a connection is taken
+} queue;
+
+/**
+ * The function performs the lines sent by the client until it disconnects.
+ * @param[in] fd : connection
+ * @param[in] memo : memory limit of the cache
+ */
+static void session(int fd, size_t memo) {
+    outputStream *Stream = OutputOpen(fd);
+    OutputRedirect(Stream, Stream);
+    PolyMemoStart(memo);
+    stack Stack = Init();
+
+    PerformInput(fd, &Stack);
+
+    OutputClose(Stream);
+    PolyMemoStop();
+    Clear(&Stack);
+}
+
+/**
+ * The function of a worker thread: it runs the sessions from the queue.
+ * @param[in] argument : queue
+ * @return NULL
+ */
+static void *worker(void *argument) {
+    queue *Queue = (queue *) argument;
+
+    while (true) {
+        pthread_mutex_lock(&(Queue->lock));
+        while (Queue->count == 0) {
+            pthread_cond_wait(&(Queue->notEmpty), &(Queue->lock));
+        }
+        int fd = Queue->fds[Queue->first];
+        Queue->first = (Queue->first + 1) % SERVER_QUEUE;
+        --Queue->count;
+        pthread_cond_signal(&(Queue->notFull));
+        pthread_mutex_unlock(&(Queue->lock));
+
+        session(fd, Queue->memo);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * The function creates the listening socket under the path.
+ * @param[in] path : path of the socket
+ * @return file descriptor, -1 on failure
+ */
+static int listenAt(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Only a socket nobody listens on is removed, never a file of another kind.
+    struct stat status;
+    if (lstat(path, &status) == 0 && S_ISSOCK(status.st_mode) &&
+        connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        unlink(path);
+    }
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool RunServer(const char *path, size_t threads, size_t memo) {
+    int listener = listenAt(path);
+    if (listener < 0) {
+        return false;
+    }
+
+    // A client that disconnects early must not stop the whole server.
+    signal(SIGPIPE, SIG_IGN);
+
+    if (threads == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = processors > 0 ? (size_t) processors : 1;
+    }
+
+    queue *Queue = (queue *) mallocSafe(sizeof(queue));
+    Queue->first = 0;
+    Queue->count = 0;
+    Queue->memo = memo;
+    pthread_mutex_init(&(Queue->lock), NULL);
+    pthread_cond_init(&(Queue->notEmpty), NULL);
+    pthread_cond_init(&(Queue->notFull), NULL);
+
+    size_t started = 0;
+    for (size_t t = 0; t < threads; ++t) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, Queue) == 0) {
+            pthread_detach(thread);
+            ++started;
+        }
+    }
+    if (started == 0) {
+        close(listener);
+        return false;
+    }
+
+    while (true) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE ||
+                errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                continue;
+            }
+            break;
+        }
+
+        pthread_mutex_lock(&(Queue->lock));
+        while (Queue->count == SERVER_QUEUE) {
+            pthread_cond_wait(&(Queue->notFull), &(Queue->lock));
+        }
+        Queue->fds[(Queue->first + Queue->count) % SERVER_QUEUE] = fd;
+        ++Queue->count;
+        pthread_cond_signal(&(Queue->notEmpty));
+        pthread_mutex_unlock(&(Queue->lock));
+    }
+
+    close(listener);
+    return false;
+}
@@ -0,0 +1,30 @@
+/** @file
+  Interface of the server mode of the calculator
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The function listens on the Unix domain socket with the given path
+ * and serves the connections until the process is stopped. Every connection
+ * is a session with a stack of its own: the lines sent by the client are
+ * performed exactly as the lines of the standard input and the output and
+ * the error messages are sent back in order. The sessions are run by a pool
+ * of threads, every session with its own cache of the results, see polyMemo.h.
+ * A socket left under the path by a server which is no longer running
+ * is replaced.
+ * @param[in] path : path of the socket
+ * @param[in] threads : number of threads, 0 for the number of processors
+ * @param[in] memo : memory limit of the cache of every session in bytes
+ * @return false when the socket cannot be created or accepting fails
+ */
+bool RunServer(const char *path, size_t threads, size_t memo);
+
+#endif /* __SERVER_H__ */
@@ -7,6 +7,7 @@
 
 #include <stdlib.h>
 #include "stack.h"
+#include "reclaim.h"
 
 /**
  * A simple function that returns approximately twice the value.
@@ -40,6 +41,7 @@ stack Init() {
     Stack.top = 0;
     Stack.sizeofArray = 0;
     Stack.Array = NULL;
+    Stack.Registers = NULL;
     return Stack;
 }
 
@@ -62,9 +64,12 @@ Poly Top(const stack *Stack) {
 
 void Clear(stack *Stack) {
     for (ullint i = 0; i < Stack->top; ++i) {
-        PolyDestroy(&Stack->Array[i]);
+        PolyDestroyDeferred(&Stack->Array[i]);
     }
     free(Stack->Array);
+    RegistersFree(Stack->Registers);
+    Stack->Registers = NULL;
+    ReclaimDrain();
     Stack->sizeofArray = 0;
     Stack->top = 0;
 }
@@ -9,6 +9,7 @@
 #define __STACK_H__
 
 #include "poly.h"
+#include "registers.h"
 
 /**
  * Shorter type notation of long long int
@@ -21,12 +22,14 @@ typedef long long int llint;
 typedef unsigned long long int ullint;
 
 /**
- * This is the structure holding the stack of polynomials.
+ * This is the structure holding the stack of polynomials
+ * together with the named registers.
  */
 typedef struct {
-    Poly *Array;         ///< array of polynomials
-    size_t sizeofArray;  ///< array size
-    ullint top;          ///< number of items on the stack
+    Poly *Array;            ///< array of polynomials
+    size_t sizeofArray;     ///< array size
+    ullint top;             ///< number of items on the stack
+    registers *Registers;   ///< named registers, NULL if there are none
 } stack;
 
 /**
@@ -64,7 +67,7 @@ Poly Pop(stack *Stack);
 Poly Top(const stack *Stack);
 
 /**
- * The function clears the entire stack.
+ * The function clears the entire stack and the registers.
  * @param[in,out] Stack : stack
  */
 void Clear(stack *Stack);
@@ -0,0 +1,308 @@
+/** @file
+  Implementation of the statistics of the lines of the calculator.
+  The memory of the polynomials is counted by the library, see
+  PolyCountMemory, the other structures of the calculator by mallocSafe.
+  The memory allocated during a line is added to the kind of the line.
+  The durations of the lines go to log-linear histograms, one for every
+  kind of lines, the way HdrHistogram does it: every power of two is divided
+  into HISTOGRAM_SUB buckets, so the percentiles are precise to about 3%.
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+#include "mallocSafe.h"
+#include "output.h"
+#include "profile.h"
+#include "reclaim.h"
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * This is the binary logarithm of the number of buckets of every power of two.
+ */
+#define HISTOGRAM_SUB_BITS 5
+
+/**
+ * This is the number of buckets of every power of two.
+ */
+#define HISTOGRAM_SUB (1 << HISTOGRAM_SUB_BITS)
+
+/**
+ * This is the number of buckets of a histogram. The durations below
+ * 2 * HISTOGRAM_SUB nanoseconds have a bucket each, the bucket of a longer
+ * duration is given by its binary logarithm and its HISTOGRAM_SUB_BITS
+ * leading bits, up to the logarithm 63, whose last bucket is
+ * (65 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB - 1, see bucketOf.
+ */
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB)
+
+/**
+ * This is the histogram of the durations of a kind of lines, in nanoseconds.
+ */
+typedef struct {
+    uint64_t max;                         ///< longest duration
+    uint32_t counts[HISTOGRAM_BUCKETS];   ///< numbers of the durations in the buckets
+} histogram;
+
+/**
+ * This is the summary of a kind of lines.
+ */
+typedef struct {
+    size_t lines;         ///< number of lines
+    size_t allocations;   ///< number of allocations made by the lines
+    size_t bytes;         ///< number of bytes allocated by the lines
+} summary;
+
+/** The names of the kinds of lines. */
+static const char *const names[STATS_KINDS] = {
+    [OP_WRONG] = "WRONG",
+    [OP_ZERO] = "ZERO",
+    [OP_IS_COEFF] = "IS_COEFF",
+    [OP_IS_ZERO] = "IS_ZERO",
+    [OP_CLONE] = "CLONE",
+    [OP_ADD] = "ADD",
+    [OP_MUL] = "MUL",
+    [OP_NEG] = "NEG",
+    [OP_SUB] = "SUB",
+    [OP_IS_EQ] = "IS_EQ",
+    [OP_DEG] = "DEG",
+    [OP_PRINT] = "PRINT",
+    [OP_POP] = "POP",
+    [OP_FORCE] = "FORCE",
+    [OP_MEMO] = "MEMO",
+    [OP_STATS] = "STATS",
+    [OP_TIMINGS] = "TIMINGS",
+    [OP_DEG_BY] = "DEG_BY",
+    [OP_AT] = "AT",
+    [OP_COMPOSE] = "COMPOSE",
+    [OP_MUL_TRUNC] = "MUL_TRUNC",
+    [OP_EXP_TRUNC] = "EXP_TRUNC",
+    [OP_SAVE] = "SAVE",
+    [OP_LOAD] = "LOAD",
+    [OP_CHECKPOINT] = "CHECKPOINT",
+    [OP_STORE] = "STORE",
+    [OP_RECALL] = "RECALL",
+    [STATS_POLY] = "POLY"
+};
+
+/** Is the memory counted? */
+static bool started = false;
+
+/** Are the lines timed? */
+static bool timed = false;
+
+/** The number of the allocations of mallocSafe. */
+static atomic_size_t safeAllocations;
+
+/** The number of the bytes allocated by mallocSafe. */
+static atomic_size_t safeBytes;
+
+/** The summaries of the kinds of lines. */
+static summary Summaries[STATS_KINDS];
+
+/** The number of allocations when the current line started. */
+static size_t allocationsBefore;
+
+/** The number of bytes allocated when the current line started. */
+static size_t bytesBefore;
+
+/** The histograms of the kinds of lines. */
+static histogram Histograms[STATS_KINDS];
+
+/** The moment the current line started. */
+static struct timespec startedAt;
+
+void SafeCount(void *pointer) {
+    if (started) {
+        atomic_fetch_add_explicit(&safeAllocations, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&safeBytes, malloc_usable_size(pointer), memory_order_relaxed);
+    }
+}
+
+void StatsStart(bool memory, bool timings) {
+    if (memory) {
+        PolyCountMemory();
+        started = true;
+    }
+    timed = timings;
+}
+
+size_t StatsKind(const line *Line) {
+    return IsCommand(Line) ? (size_t) Decode(Line) : STATS_POLY;
+}
+
+const char *StatsName(size_t kind) {
+    return names[kind];
+}
+
+/**
+ * The function gives the numbers of all the allocations and bytes so far.
+ * @param[out] allocations : number of allocations
+ * @param[out] bytes : number of bytes
+ */
+static void totals(size_t *allocations, size_t *bytes) {
+    PolyMemoryCounters counters;
+    PolyGetMemoryCounters(&counters);
+
+    *allocations = counters.allocations +
+                   atomic_load_explicit(&safeAllocations, memory_order_relaxed);
+    *bytes = counters.bytes + atomic_load_explicit(&safeBytes, memory_order_relaxed);
+}
+
+/**
+ * The function gives the bucket of a duration.
+ * @param[in] duration : duration in nanoseconds
+ * @return bucket
+ */
+static size_t bucketOf(uint64_t duration) {
+    if (duration < 2 * HISTOGRAM_SUB) {
+        return (size_t) duration;
+    }
+
+    int shift = 63 - __builtin_clzll(duration) - HISTOGRAM_SUB_BITS;
+    return (size_t) shift * HISTOGRAM_SUB + (size_t) (duration >> shift);
+}
+
+/**
+ * The function gives the longest duration of a bucket.
+ * @param[in] bucket : bucket
+ * @return duration in nanoseconds
+ */
+static uint64_t bucketTop(size_t bucket) {
+    if (bucket < 2 * HISTOGRAM_SUB) {
+        return bucket;
+    }
+
+    size_t shift = bucket / HISTOGRAM_SUB - 1;
+    uint64_t leading = bucket % HISTOGRAM_SUB + HISTOGRAM_SUB;
+    return ((leading + 1) << shift) - 1;
+}
+
+/**
+ * The function gives a percentile of the durations of a histogram.
+ * @param[in] Histogram : histogram
+ * @param[in] count : number of the durations
+ * @param[in] percent : percentile
+ * @return duration in nanoseconds, at most the longest one
+ */
+static uint64_t percentile(const histogram *Histogram, size_t count, size_t percent) {
+    size_t rank = (count * percent + 99) / 100;
+    size_t seen = 0;
+
+    for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+        seen += Histogram->counts[bucket];
+        if (seen >= rank) {
+            uint64_t top = bucketTop(bucket);
+            return top < Histogram->max ? top : Histogram->max;
+        }
+    }
+
+    return Histogram->max;
+}
+
+void StatsBegin(void) {
+    if (started) {
+        totals(&allocationsBefore, &bytesBefore);
+    }
+    if (timed) {
+        clock_gettime(CLOCK_MONOTONIC, &startedAt);
+    }
+    ProfileBegin();
+}
+
+void StatsEnd(size_t kind) {
+    ProfileEnd(kind);
+
+    summary *Summary = &(Summaries[kind]);
+    ++Summary->lines;
+
+    if (timed) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t duration = (uint64_t) (now.tv_sec - startedAt.tv_sec) * 1000000000u +
+                            (uint64_t) now.tv_nsec - (uint64_t) startedAt.tv_nsec;
+
+        histogram *Histogram = &(Histograms[kind]);
+        ++Histogram->counts[bucketOf(duration)];
+        if (duration > Histogram->max) {
+            Histogram->max = duration;
+        }
+    }
+    if (started) {
+        size_t allocations;
+        size_t bytes;
+        totals(&allocations, &bytes);
+
+        Summary->allocations += allocations - allocationsBefore;
+        Summary->bytes += bytes - bytesBefore;
+    }
+}
+
+/**
+ * The function writes the percentiles of the durations of a kind of lines.
+ * @param[out] letters : buffer
+ * @param[in] size : size of the buffer
+ * @param[in] kind : kind of lines
+ */
+static void printTimings(char *letters, size_t size, size_t kind) {
+    const histogram *Histogram = &(Histograms[kind]);
+    size_t count = Summaries[kind].lines;
+
+    snprintf(letters, size, "%s count %zu p50 %llu p99 %llu max %llu\n", names[kind], count,
+             (unsigned long long) percentile(Histogram, count, 50),
+             (unsigned long long) percentile(Histogram, count, 99),
+             (unsigned long long) Histogram->max);
+}
+
+void StatsTimings(void) {
+    char letters[128];
+
+    if (!timed) {
+        return;
+    }
+    for (size_t kind = 0; kind < STATS_KINDS; ++kind) {
+        if (Summaries[kind].lines > 0) {
+            printTimings(letters, sizeof(letters), kind);
+            OutputString(letters);
+        }
+    }
+}
+
+void StatsReport(void) {
+    if (timed) {
+        char letters[128];
+
+        for (size_t kind = 0; kind < STATS_KINDS; ++kind) {
+            if (Summaries[kind].lines > 0) {
+                printTimings(letters, sizeof(letters), kind);
+                fprintf(stderr, "TIMINGS %s", letters);
+            }
+        }
+    }
+    ProfileReport();
+    if (!started) {
+        return;
+    }
+
+    ReclaimDrain();
+    for (size_t kind = 0; kind < STATS_KINDS; ++kind) {
+        const summary *Summary = &(Summaries[kind]);
+        if (Summary->lines > 0) {
+            fprintf(stderr, "STATS %s lines %zu allocations %zu bytes %zu\n", names[kind],
+                    Summary->lines, Summary->allocations, Summary->bytes);
+        }
+    }
+
+    PolyMemoryCounters counters;
+    PolyGetMemoryCounters(&counters);
+    fprintf(stderr, "STATS TOTAL allocations %zu bytes %zu live %zu peak %zu\n",
+            counters.allocations + atomic_load_explicit(&safeAllocations, memory_order_relaxed),
+            counters.bytes + atomic_load_explicit(&safeBytes, memory_order_relaxed),
+            counters.live, counters.peak);
+}
@@ -0,0 +1,76 @@
+/** @file
+  Interface of the statistics of the lines of the calculator: the memory
+  they allocate and the time they take
+
+  @author agent <agent@local>
+  @date 2026
+*/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "command.h"
+
+/**
+ * This is the kind of the lines with polynomials. The kind of a line
+ * with a command is its opcode, OP_WRONG for a wrong command.
+ */
+#define STATS_POLY (OP_RECALL + 1)
+
+/**
+ * This is the number of the kinds of lines.
+ */
+#define STATS_KINDS (STATS_POLY + 1)
+
+/**
+ * The function starts the statistics. Counting the memory, see PolyCountMemory,
+ * has to be started before any polynomial is created.
+ * @param[in] memory : Is the memory counted?
+ * @param[in] timings : Are the lines timed?
+ */
+void StatsStart(bool memory, bool timings);
+
+/**
+ * The function gives the kind of a line which is neither empty nor a comment.
+ * @param[in] Line : line
+ * @return kind of the line
+ */
+size_t StatsKind(const line *Line);
+
+/**
+ * The function gives the name of a kind of lines.
+ * @param[in] kind : kind of lines
+ * @return name
+ */
+const char *StatsName(size_t kind);
+
+/**
+ * The function notes the counters, the monotonic clock and the performance
+ * counters, see profile.h, before a line is performed.
+ */
+void StatsBegin(void);
+
+/**
+ * The function adds the allocations made since StatsBegin
+ * to the summary of the kind of the line, the time elapsed
+ * to its histogram and the performance counts to its profile.
+ * @param[in] kind : kind of the line
+ */
+void StatsEnd(size_t kind);
+
+/**
+ * The function prints the number of lines, the median, the 99th percentile
+ * and the maximum of the durations of every kind of lines performed so far,
+ * in nanoseconds, one line each. It prints nothing unless the lines are timed.
+ */
+void StatsTimings(void);
+
+/**
+ * The function writes the timings of the kinds of lines, see StatsTimings,
+ * their profiles, see ProfileReport, the summary of their allocations
+ * and the memory counters
+ * to the standard error, one line each.
+ */
+void StatsReport(void);
+
+#endif /* __STATS_H__ */